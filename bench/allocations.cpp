@@ -0,0 +1,44 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "bench.h"
+
+//every allocation in the benchmark binary goes through here so benchmarks can count them
+
+static std::atomic<std::size_t> allocations(0);
+
+std::size_t wevents::bench::allocation_count()
+    { return allocations.load(std::memory_order_relaxed); }
+
+void *operator new(std::size_t size)
+    {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+        { return ptr; }
+    throw std::bad_alloc();
+    }
+
+void *operator new[](std::size_t size)
+    { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+    {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+    }
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+    { return operator new(size, tag); }
+
+void operator delete(void *ptr) noexcept
+    { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept
+    { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept
+    { std::free(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept
+    { std::free(ptr); }
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "bench.h"
+#include "../src/w_event.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    const std::size_t EMITS = 200000;
+
+    //time from the first emit until every posted call has run
+    template<class Emit, class Done>
+    double emits_per_second(Emit &&emit, Done &&done)
+        {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < EMITS; i++)
+            { emit(); }
+        while (!done())
+            { std::this_thread::yield(); }
+        auto end = std::chrono::steady_clock::now();
+        return EMITS / std::chrono::duration<double>(end - start).count();
+        }
+
+    void measure_pool(std::size_t threads)
+        {
+        WThreadPool pool(threads);
+        WSignal<int> signal;
+        std::atomic<std::size_t> calls(0);
+        connect(
+                signal, [&calls](int)
+                    { calls.fetch_add(1, std::memory_order_relaxed); }, ConOps().executor(pool)
+        );
+
+        std::size_t before = allocation_count();
+        double rate = emits_per_second(
+                [&]()
+                    { signal.emit(1); },
+                [&]()
+                    { return calls.load(std::memory_order_relaxed) == EMITS; }
+        );
+        std::size_t allocations = allocation_count() - before;
+
+        report(
+                "async_emit/thread_pool/" + std::to_string(threads), {
+                        {"threads", threads},
+                        {"emits_per_second", rate},
+                        {"heap_allocations_per_emit", double(allocations) / EMITS}
+                }
+        );
+        }
+
+    void measure_event_loop()
+        {
+        WEventLoop loop;
+        WSignal<int> signal;
+        std::size_t calls = 0;
+        std::atomic<bool> finished(false);
+        connect(
+                signal, [&](int)
+                    {
+                    if (++calls == EMITS)
+                        { finished.store(true, std::memory_order_release); }
+                    }, ConOps().queued(loop)
+        );
+        std::thread consumer([&loop]()
+            { loop.run(); });
+
+        std::size_t before = allocation_count();
+        double rate = emits_per_second(
+                [&]()
+                    { signal.emit(1); },
+                [&]()
+                    { return finished.load(std::memory_order_acquire); }
+        );
+        std::size_t allocations = allocation_count() - before;
+        loop.quit();
+        consumer.join();
+
+        WEventLoopStats stats = loop.stats();
+        report(
+                "async_emit/event_loop", {
+                        {"emits_per_second", rate},
+                        {"heap_allocations_per_emit", double(allocations) / EMITS},
+                        {"peak_queue_depth", stats.peak_pending},
+                        {"average_batch", stats.average_batch()}
+                }
+        );
+        }
+    }
+
+WEVENTS_BENCHMARK(async_emit)
+    {
+    for (std::size_t threads : {1, 4})
+        { measure_pool(threads); }
+    measure_event_loop();
+    }
@@ -0,0 +1,85 @@
+#ifndef WEVENTS_BENCH_H
+#define WEVENTS_BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wevents
+    {
+    namespace bench
+        {
+        typedef std::vector<std::pair<std::string, double> > Metrics;
+
+        struct Result
+            {
+            std::string name;
+            Metrics metrics;
+            };
+
+        typedef void (*Function)();
+
+        inline std::vector<std::pair<std::string, Function> > &benchmarks()
+            {
+            static std::vector<std::pair<std::string, Function> > list;
+            return list;
+            }
+
+        inline std::vector<Result> &results()
+            {
+            static std::vector<Result> list;
+            return list;
+            }
+
+        struct Registrar
+            {
+            Registrar(const char *name, Function function)
+                { benchmarks().emplace_back(name, function); }
+            };
+
+        inline void report(const std::string &name, Metrics metrics)
+            { results().push_back({name, std::move(metrics)}); }
+
+        //everything reported so far as json on stdout
+        inline void print_results()
+            {
+            std::printf("{\n  \"benchmarks\": [");
+            for (std::size_t i = 0; i < results().size(); i++)
+                {
+                const Result &result = results()[i];
+                std::printf("%s\n    {\"name\": \"%s\"", i == 0 ? "" : ",", result.name.c_str());
+                for (auto &metric : result.metrics)
+                    { std::printf(", \"%s\": %.3f", metric.first.c_str(), metric.second); }
+                std::printf("}");
+                }
+            std::printf("\n  ]\n}\n");
+            }
+
+        //number of calls to operator new made by the process so far, see allocations.cpp
+        std::size_t allocation_count();
+
+        template<class T>
+        inline void do_not_optimize(T &value)
+            { asm volatile("" : : "r,m"(value) : "memory"); }
+
+        template<class F>
+        double ns_per_op(std::size_t iterations, F &&function)
+            {
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < iterations; i++)
+                { function(); }
+            auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+            }
+        }
+    }
+
+#define WEVENTS_BENCHMARK(name) \
+    static void name(); \
+    static wevents::bench::Registrar name##_registrar(#name, &name); \
+    static void name()
+
+#endif //WEVENTS_BENCH_H
@@ -0,0 +1,52 @@
+#include <string>
+
+#include "bench.h"
+#include "../src/w_event.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    class Subscriber : public WSlotObject
+        {
+    public:
+        void on_value(const std::string &)
+            {}
+        };
+
+    const std::size_t PAIRS = 200000;
+    }
+
+//short lived subscriptions, connection objects and their bookkeeping should come out of the pool
+WEVENTS_BENCHMARK(connect_churn)
+    {
+    WSignal<const std::string &> signal;
+    Subscriber subscriber;
+    for (int i = 0; i < 8; i++)
+        { connect(signal, &Subscriber::on_value, &subscriber); }
+
+    for (std::size_t i = 0; i < 1000; i++)
+        { connect(signal, &Subscriber::on_value, &subscriber)(); }
+
+    WPoolStats pool_before = pool_stats();
+    std::size_t before = allocation_count();
+    double ns = ns_per_op(
+            PAIRS, [&]()
+                { connect(signal, &Subscriber::on_value, &subscriber)(); }
+    );
+    std::size_t allocations = allocation_count() - before;
+    WPoolStats pool_after = pool_stats();
+
+    double pool_requests = double(pool_after.allocations - pool_before.allocations);
+    double pool_saved = double(pool_after.saved() - pool_before.saved());
+    report(
+            "connect_churn", {
+                    {"ns_per_connect_disconnect", ns},
+                    {"heap_allocations_per_pair", double(allocations) / PAIRS},
+                    {"pool_allocations_per_pair", pool_requests / PAIRS},
+                    {"pool_saved_allocations_per_pair", pool_saved / PAIRS},
+                    {"pool_bytes_reserved", double(pool_after.bytes_reserved)}
+            }
+    );
+    }
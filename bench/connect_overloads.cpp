@@ -0,0 +1,81 @@
+#include <string>
+
+#include "bench.h"
+#include "../src/w_event.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    class Receiver : public WSlotObject
+        {
+    public:
+        int total = 0;
+
+        void on_value(int value)
+            { total += value; }
+        };
+
+    const std::size_t PAIRS = 200000;
+
+    //cost of making and then dropping one connection, with a few others already on the signal
+    template<class F>
+    void measure_connect(const std::string &name, WSignal<int> &, F &&make)
+        {
+        for (std::size_t i = 0; i < 1000; i++)
+            { make().disconnect(); }
+
+        std::size_t before = allocation_count();
+        double ns = ns_per_op(
+                PAIRS, [&]()
+                    { make().disconnect(); }
+        );
+        std::size_t allocations = allocation_count() - before;
+
+        report(
+                "connect/" + name, {
+                        {"ns_per_connect_disconnect", ns},
+                        {"heap_allocations_per_pair", double(allocations) / PAIRS}
+                }
+        );
+        }
+    }
+
+WEVENTS_BENCHMARK(connect_overloads)
+    {
+    WSignal<int> signal;
+    WSignal<int> target;
+    Receiver receiver;
+    int total = 0;
+    for (int i = 0; i < 8; i++)
+        { connect(signal, &Receiver::on_value, &receiver); }
+
+    measure_connect(
+            "callback", signal, [&]()
+                {
+                return connect(
+                        signal, [&total](int value)
+                            { total += value; }
+                );
+                }
+    );
+    measure_connect(
+            "method", signal, [&]()
+                { return connect(signal, &Receiver::on_value, &receiver); }
+    );
+    measure_connect(
+            "lifetime", signal, [&]()
+                {
+                return connect(
+                        signal, [&total](int value)
+                            { total += value; }, &receiver
+                );
+                }
+    );
+    measure_connect(
+            "signal", signal, [&]()
+                { return connect(signal, target); }
+    );
+    do_not_optimize(total);
+    }
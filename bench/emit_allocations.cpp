@@ -0,0 +1,75 @@
+#include <mutex>
+#include <string>
+
+#include "bench.h"
+#include "../src/w_event.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    class Receiver : public WSlotObject
+        {
+    public:
+        std::size_t total = 0;
+
+        void on_value(const std::string &name, int value)
+            { total += name.size() + value; }
+        };
+
+    const std::size_t EMITS = 100000;
+
+    //synchronous emits pass the arguments by reference so they should never touch the heap
+    void measure_sync_emit(std::size_t connections)
+        {
+        WSignal<const std::string &, int> signal;
+        Receiver receiver;
+        std::mutex mutex;
+        std::size_t total = 0;
+
+        for (std::size_t i = 0; i < connections; i++)
+            {
+            switch (i % 3)
+                {
+                case 0:
+                    connect(
+                            signal, [&total](const std::string &name, int value)
+                                { total += name.size() + value; }
+                    );
+                    break;
+                case 1:
+                    connect(signal, &Receiver::on_value, &receiver);
+                    break;
+                default:
+                    connect(signal, &Receiver::on_value, &receiver, ConOps().mutex(mutex));
+                    break;
+                }
+            }
+
+        const std::string name = "a string that does not fit into the small string buffer";
+        signal.emit(name, 1);
+
+        std::size_t before = allocation_count();
+        double ns = ns_per_op(
+                EMITS, [&]()
+                    { signal.emit(name, 1); }
+        );
+        std::size_t allocations = allocation_count() - before;
+        do_not_optimize(total);
+
+        report(
+                "sync_emit_allocations/" + std::to_string(connections), {
+                        {"connections", connections},
+                        {"ns_per_emit", ns},
+                        {"allocations_per_emit", double(allocations) / EMITS}
+                }
+        );
+        }
+    }
+
+WEVENTS_BENCHMARK(sync_emit_allocations)
+    {
+    for (std::size_t connections : {1, 8, 64})
+        { measure_sync_emit(connections); }
+    }
@@ -0,0 +1,90 @@
+#include <string>
+
+#include "bench.h"
+#include "../src/w_event.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    //roughly the same number of slot calls for every connection count
+    const std::size_t CALLS = 4000000;
+
+    void measure_emit(std::size_t connections)
+        {
+        WSignal<int> signal;
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < connections; i++)
+            {
+            connect(
+                    signal, [&total](int value)
+                        { total += value; }
+            );
+            }
+
+        std::size_t emits = CALLS / (connections == 0 ? 1 : connections);
+        if (emits > 1000000)
+            { emits = 1000000; }
+        for (std::size_t i = 0; i < 1000; i++)
+            { signal.emit(1); }
+
+        double ns = ns_per_op(
+                emits, [&]()
+                    { signal.emit(1); }
+        );
+        do_not_optimize(total);
+
+        report(
+                "emit_latency/" + std::to_string(connections), {
+                        {"connections", connections},
+                        {"ns_per_emit", ns},
+                        {"ns_per_slot", connections == 0 ? ns : ns / connections}
+                }
+        );
+        }
+
+    //a by value argument too long for the small string buffer, every copy of it allocates
+    void measure_emit_string(std::size_t connections)
+        {
+        WSignal<std::string> signal;
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < connections; i++)
+            {
+            connect(
+                    signal, [&total](const std::string &value)
+                        { total += value.size(); }
+            );
+            }
+
+        const std::string value(64, 'x');
+        std::size_t emits = CALLS / 4 / connections;
+        for (std::size_t i = 0; i < 1000; i++)
+            { signal.emit(value); }
+
+        std::size_t before = allocation_count();
+        double ns = ns_per_op(
+                emits, [&]()
+                    { signal.emit(value); }
+        );
+        std::size_t allocations = allocation_count() - before;
+        do_not_optimize(total);
+
+        report(
+                "emit_latency/string/" + std::to_string(connections), {
+                        {"connections", connections},
+                        {"ns_per_emit", ns},
+                        {"ns_per_slot", ns / connections},
+                        {"heap_allocations_per_emit", double(allocations) / emits}
+                }
+        );
+        }
+    }
+
+WEVENTS_BENCHMARK(emit_latency)
+    {
+    for (std::size_t connections : {0, 1, 8, 64, 1024})
+        { measure_emit(connections); }
+    for (std::size_t connections : {1, 8, 64})
+        { measure_emit_string(connections); }
+    }
@@ -0,0 +1,97 @@
+#ifndef WEVENTS_BENCH_HISTOGRAM_H
+#define WEVENTS_BENCH_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace wevents
+    {
+    namespace bench
+        {
+        //log linear latency histogram, every power of two is split into SUB_BUCKETS so a percentile
+        //is off by at most 1/SUB_BUCKETS. Counter is std::uint64_t for per thread histograms that are
+        //merged afterwards and std::atomic<std::uint64_t> for ones written by several threads
+        template<class Counter>
+        class Histogram
+            {
+        public:
+            static const std::size_t SUB_BITS = 3;
+            static const std::size_t SUB_BUCKETS = 1 << SUB_BITS;
+            static const std::size_t BUCKETS = 64 * SUB_BUCKETS;
+
+        private:
+            Counter counts[BUCKETS];
+
+            static std::size_t bucket(std::uint64_t value)
+                {
+                if (value < SUB_BUCKETS)
+                    { return std::size_t(value); }
+                std::size_t msb = 63 - __builtin_clzll(value);
+                std::size_t sub = std::size_t(value >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1);
+                return (msb - SUB_BITS + 1) * SUB_BUCKETS + sub;
+                }
+
+            //largest value that falls into the bucket
+            static std::uint64_t upper_bound(std::size_t index)
+                {
+                if (index < SUB_BUCKETS)
+                    { return index; }
+                std::size_t msb = index / SUB_BUCKETS + SUB_BITS - 1;
+                std::uint64_t sub = index % SUB_BUCKETS;
+                std::uint64_t low = (std::uint64_t(1) << msb) | (sub << (msb - SUB_BITS));
+                return low + (std::uint64_t(1) << (msb - SUB_BITS)) - 1;
+                }
+
+        public:
+            Histogram()
+                {
+                for (std::size_t i = 0; i < BUCKETS; i++)
+                    { counts[i] = 0; }
+                }
+
+            void record(std::uint64_t value)
+                { counts[bucket(value)] += 1; }
+
+            template<class Other>
+            void merge(const Histogram<Other> &other)
+                {
+                for (std::size_t i = 0; i < BUCKETS; i++)
+                    { counts[i] += other.count(i); }
+                }
+
+            std::uint64_t count(std::size_t index) const
+                { return counts[index]; }
+
+            std::uint64_t total() const
+                {
+                std::uint64_t sum = 0;
+                for (std::size_t i = 0; i < BUCKETS; i++)
+                    { sum += counts[i]; }
+                return sum;
+                }
+
+            //fraction between 0 and 1
+            std::uint64_t percentile(double fraction) const
+                {
+                std::uint64_t all = total();
+                if (all == 0)
+                    { return 0; }
+                std::uint64_t rank = std::uint64_t(fraction * double(all - 1)) + 1;
+                std::uint64_t seen = 0;
+                for (std::size_t i = 0; i < BUCKETS; i++)
+                    {
+                    seen += counts[i];
+                    if (seen >= rank)
+                        { return upper_bound(i); }
+                    }
+                return upper_bound(BUCKETS - 1);
+                }
+            };
+
+        typedef Histogram<std::uint64_t> LocalHistogram;
+        typedef Histogram<std::atomic<std::uint64_t> > SharedHistogram;
+        }
+    }
+
+#endif //WEVENTS_BENCH_HISTOGRAM_H
@@ -0,0 +1,29 @@
+#include <cstdio>
+#include <string>
+
+#include "bench.h"
+
+using namespace wevents::bench;
+
+//runs every benchmark whose name contains one of the arguments (or all of them) and writes
+//the results to stdout as json, progress goes to stderr
+int main(int argc, char **argv)
+    {
+    for (auto &benchmark : benchmarks())
+        {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++)
+            {
+            if (benchmark.first.find(argv[i]) != std::string::npos)
+                { selected = true; }
+            }
+        if (!selected)
+            { continue; }
+
+        std::fprintf(stderr, "running %s\n", benchmark.first.c_str());
+        benchmark.second();
+        }
+
+    print_results();
+    return 0;
+    }
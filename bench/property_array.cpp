@@ -0,0 +1,111 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "../src/w_property_array.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    const std::size_t ELEMENT_UPDATES = 20000000;
+
+    std::size_t updates_for(std::size_t size)
+        {
+        std::size_t updates = ELEMENT_UPDATES / size;
+        return updates > 200000 ? 200000 : updates;
+        }
+
+    //result = a * k + b as one array, one element written per sparse update, k written per full update
+    void measure_array(std::size_t size)
+        {
+        WPropertyArray<int> a(size, 1);
+        WPropertyArray<int> b(size, 2);
+        WProperty<int> k(3);
+        WPropertyArray<int> result = a * k + b;
+
+        const std::size_t sparse_updates = 1000000;
+        std::size_t next = 0;
+        double sparse_ns = ns_per_op(
+                sparse_updates, [&]()
+                    {
+                    a.set(next % size, int(next));
+                    next++;
+                    }
+        );
+
+        std::size_t updates = updates_for(size);
+        double full_ns = ns_per_op(
+                updates, [&]()
+                    { k = int(next++); }
+        );
+        int last = result.get(size - 1);
+        do_not_optimize(last);
+
+        report(
+                "property_array/array/" + std::to_string(size), {
+                        {"size", size},
+                        {"ns_per_sparse_update", sparse_ns},
+                        {"ns_per_full_update", full_ns},
+                        {"ns_per_element", full_ns / size},
+                        //the value plus the written and changed bits
+                        {"bytes_per_element", sizeof(int) + 2.0 / 8}
+                }
+        );
+        }
+
+    //the same computation as size separate properties
+    void measure_scalars(std::size_t size)
+        {
+        std::vector<std::unique_ptr<WProperty<int> > > a;
+        std::vector<std::unique_ptr<WProperty<int> > > b;
+        std::vector<std::unique_ptr<WProperty<int> > > result;
+        WProperty<int> k(3);
+        for (std::size_t i = 0; i < size; i++)
+            {
+            a.emplace_back(new WProperty<int>(1));
+            b.emplace_back(new WProperty<int>(2));
+            result.emplace_back(new WProperty<int>(*a.back() * k + *b.back()));
+            }
+
+        const std::size_t sparse_updates = 1000000;
+        std::size_t next = 0;
+        double sparse_ns = ns_per_op(
+                sparse_updates, [&]()
+                    {
+                    *a[next % size] = int(next);
+                    next++;
+                    }
+        );
+
+        std::size_t updates = updates_for(size);
+        double full_ns = ns_per_op(
+                updates, [&]()
+                    { k = int(next++); }
+        );
+        int last = result.back()->get();
+        do_not_optimize(last);
+        result.clear();
+
+        report(
+                "property_array/scalars/" + std::to_string(size), {
+                        {"size", size},
+                        {"ns_per_sparse_update", sparse_ns},
+                        {"ns_per_full_update", full_ns},
+                        {"ns_per_element", full_ns / size},
+                        {"bytes_per_element", sizeof(WProperty<int>)}
+                }
+        );
+        }
+    }
+
+WEVENTS_BENCHMARK(property_array)
+    {
+    for (std::size_t size : {256, 4096, 65536})
+        {
+        measure_array(size);
+        measure_scalars(size);
+        }
+    }
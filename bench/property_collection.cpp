@@ -0,0 +1,156 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "../src/w_property_collection.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    struct Order
+        {
+        int price;
+        int quantity;
+
+        bool operator==(const Order &other) const
+            { return price == other.price && quantity == other.quantity; }
+        };
+
+    std::vector<Order> make_book(std::size_t size)
+        {
+        std::vector<Order> book;
+        for (std::size_t i = 0; i < size; i++)
+            { book.push_back(Order{int(i * 7919 % size), int(i % 100)}); }
+        return book;
+        }
+
+    bool is_large(const Order &order)
+        { return order.quantity >= 50; }
+
+    //a few orders of a book of size change per update, the large ones and their total are kept
+    void measure_incremental(std::size_t size)
+        {
+        WPropertyVector<Order> book(make_book(size));
+        WPropertyVector<Order> large = filtered(book, is_large);
+        WProperty<int> total = summed(
+                large, [](const Order &order)
+                    { return order.quantity; }
+        );
+
+        const std::size_t updates = 200000;
+        std::size_t next = 0;
+        double ns = ns_per_op(
+                updates, [&]()
+                    {
+                    WPropertyTransaction batch;
+                    for (std::size_t i = 0; i < 4; i++)
+                        {
+                        std::size_t index = (next * 4099 + i) % size;
+                        book.set(index, Order{book.get(index).price, int(next % 100)});
+                        }
+                    next++;
+                    }
+        );
+        int last = total.get();
+        do_not_optimize(last);
+
+        report(
+                "property_collection/incremental/" + std::to_string(size), {
+                        {"size", size},
+                        {"ns_per_update", ns}
+                }
+        );
+        }
+
+    //orders come and go in the middle of the book, the filter moves every flag after them
+    void measure_churn(std::size_t size)
+        {
+        WPropertyVector<Order> book(make_book(size));
+        WPropertyVector<Order> large = filtered(book, is_large);
+
+        const std::size_t updates = 100000;
+        std::size_t next = 0;
+        double ns = ns_per_op(
+                updates, [&]()
+                    {
+                    std::size_t index = (next * 4099) % size;
+                    book.insert(index, Order{int(next), int(next % 100)});
+                    book.erase((index * 7 + 1) % size);
+                    next++;
+                    }
+        );
+        std::size_t last = large.values().size();
+        do_not_optimize(last);
+
+        report(
+                "property_collection/churn/" + std::to_string(size), {
+                        {"size", size},
+                        {"ns_per_insert_erase", ns}
+                }
+        );
+        }
+
+    //the same with the whole book in one property that is filtered and summed again on every update
+    void measure_rescan(std::size_t size)
+        {
+        WProperty<std::vector<Order> > book(make_book(size));
+        WProperty<std::vector<Order> > large(
+                [](const std::vector<Order> &orders)
+                    {
+                    std::vector<Order> result;
+                    for (const Order &order : orders)
+                        {
+                        if (is_large(order))
+                            { result.push_back(order); }
+                        }
+                    return result;
+                    }, book
+        );
+        WProperty<int> total(
+                [](const std::vector<Order> &orders)
+                    {
+                    int sum = 0;
+                    for (const Order &order : orders)
+                        { sum += order.quantity; }
+                    return sum;
+                    }, large
+        );
+
+        const std::size_t updates = 200000000 / size;
+        std::size_t next = 0;
+        double ns = ns_per_op(
+                updates, [&]()
+                    {
+                    book.operate(
+                            [&next, size](std::vector<Order> &orders)
+                                {
+                                for (std::size_t i = 0; i < 4; i++)
+                                    { orders[(next * 4099 + i) % size].quantity = int(next % 100); }
+                                }
+                    );
+                    next++;
+                    }
+        );
+        int last = total.get();
+        do_not_optimize(last);
+
+        report(
+                "property_collection/rescan/" + std::to_string(size), {
+                        {"size", size},
+                        {"ns_per_update", ns}
+                }
+        );
+        }
+    }
+
+WEVENTS_BENCHMARK(property_collection)
+    {
+    for (std::size_t size : {1000, 100000})
+        {
+        measure_incremental(size);
+        measure_churn(size);
+        measure_rescan(size);
+        }
+    }
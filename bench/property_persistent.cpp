@@ -0,0 +1,75 @@
+#include <map>
+#include <string>
+
+#include "bench.h"
+#include "../src/w_persistent.h"
+#include "../src/w_property.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    void set(std::map<int, int> &map, int key, int value)
+        { map[key] = value; }
+
+    void set(WPersistentMap<int, int> &map, int key, int value)
+        { map.set(key, value); }
+
+    //a property holding size entries: a write followed by a snapshot of the value, as a reader keeping
+    //the last version would take, and an alias that is bound to it then detached by its own write
+    template<class Map>
+    void measure(const std::string &kind, std::size_t size, std::size_t operations)
+        {
+        Map initial;
+        for (std::size_t i = 0; i < size; i++)
+            { set(initial, int(i), int(i)); }
+        WProperty<Map> book(initial);
+
+        int next = 0;
+        Map snapshot;
+        double snapshot_ns = ns_per_op(
+                operations, [&]()
+                    {
+                    book.operate(
+                            [&next, size](Map &map)
+                                { set(map, int(next % size), next); }
+                    );
+                    next++;
+                    snapshot = book.get();
+                    }
+        );
+
+        WProperty<Map> view(initial);
+        double detach_ns = ns_per_op(
+                operations, [&]()
+                    {
+                    view = book;
+                    view.operate(
+                            [&next, size](Map &map)
+                                { set(map, int(next % size), next); }
+                    );
+                    next++;
+                    }
+        );
+        std::size_t last = view.get().size() + snapshot.size();
+        do_not_optimize(last);
+
+        report(
+                "property_persistent/" + kind + "/" + std::to_string(size), {
+                        {"size", size},
+                        {"ns_per_write_and_snapshot", snapshot_ns},
+                        {"ns_per_bind_and_detach", detach_ns}
+                }
+        );
+        }
+    }
+
+WEVENTS_BENCHMARK(property_persistent)
+    {
+    for (std::size_t size : {100, 10000, 100000})
+        {
+        measure<std::map<int, int> >("std_map", size, 2000000 / size);
+        measure<WPersistentMap<int, int> >("persistent_map", size, 200000);
+        }
+    }
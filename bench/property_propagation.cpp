@@ -0,0 +1,497 @@
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "../src/w_property.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    const std::size_t UPDATES_PER_NODE = 2000000;
+
+    std::size_t updates_for(std::size_t nodes)
+        {
+        std::size_t updates = UPDATES_PER_NODE / nodes;
+        return updates > 100000 ? 100000 : updates;
+        }
+
+    //dependents have to go before what they depend on
+    void destroy_backwards(std::vector<std::unique_ptr<WProperty<int> > > &properties)
+        {
+        while (!properties.empty())
+            { properties.pop_back(); }
+        }
+
+    //source -> p1 -> p2 -> ... -> pN, every update walks the whole chain
+    void measure_chain(std::size_t length)
+        {
+        std::vector<std::unique_ptr<WProperty<int> > > properties;
+        properties.emplace_back(new WProperty<int>(0));
+        for (std::size_t i = 0; i < length; i++)
+            {
+            properties.emplace_back(
+                    new WProperty<int>(
+                            [](int value)
+                                { return value + 1; }, *properties.back()
+                    )
+            );
+            }
+
+        WProperty<int> &source = *properties.front();
+        std::size_t updates = updates_for(length);
+        std::size_t before = allocation_count();
+        double ns = ns_per_op(
+                updates, [&]()
+                    { source.operate([](int &value) { value++; }); }
+        );
+        std::size_t allocations = allocation_count() - before;
+        int last = properties.back()->get();
+        do_not_optimize(last);
+        destroy_backwards(properties);
+
+        report(
+                "property_chain/" + std::to_string(length), {
+                        {"length", length},
+                        {"ns_per_update", ns},
+                        {"ns_per_node", ns / length},
+                        {"allocations_per_update", double(allocations) / updates}
+                }
+        );
+        }
+
+    //one source with width expressions reading it directly
+    void measure_fan_out(std::size_t width)
+        {
+        std::vector<std::unique_ptr<WProperty<int> > > properties;
+        properties.emplace_back(new WProperty<int>(0));
+        WProperty<int> &source = *properties.front();
+        for (std::size_t i = 0; i < width; i++)
+            {
+            properties.emplace_back(
+                    new WProperty<int>(
+                            [i](int value)
+                                { return value + int(i); }, source
+                    )
+            );
+            }
+
+        std::size_t updates = updates_for(width);
+        std::size_t before = allocation_count();
+        double ns = ns_per_op(
+                updates, [&]()
+                    { source.operate([](int &value) { value++; }); }
+        );
+        std::size_t allocations = allocation_count() - before;
+        int last = properties.back()->get();
+        do_not_optimize(last);
+        destroy_backwards(properties);
+
+        report(
+                "property_fan_out/" + std::to_string(width), {
+                        {"width", width},
+                        {"ns_per_update", ns},
+                        {"ns_per_node", ns / width},
+                        {"allocations_per_update", double(allocations) / updates}
+                }
+        );
+        }
+
+    //layers of two nodes that both read both nodes of the layer above, so there are 2^depth paths
+    //from the source to the last layer but only 2 * depth nodes to recompute
+    void measure_lattice(std::size_t depth)
+        {
+        std::size_t recomputes = 0;
+        std::vector<std::unique_ptr<WProperty<int> > > properties;
+        properties.emplace_back(new WProperty<int>(0));
+        WProperty<int> *left = properties.back().get();
+        WProperty<int> *right = left;
+        for (std::size_t i = 0; i < depth; i++)
+            {
+            properties.emplace_back(
+                    new WProperty<int>(
+                            [&recomputes](int l, int r)
+                                {
+                                recomputes++;
+                                return l + r;
+                                }, *left, *right
+                    )
+            );
+            properties.emplace_back(
+                    new WProperty<int>(
+                            [&recomputes](int l, int r)
+                                {
+                                recomputes++;
+                                return l - r;
+                                }, *left, *right
+                    )
+            );
+            left = properties[properties.size() - 2].get();
+            right = properties.back().get();
+            }
+
+        WProperty<int> &source = *properties.front();
+        std::size_t updates = updates_for(2 * depth);
+        recomputes = 0;
+        double ns = ns_per_op(
+                updates, [&]()
+                    { source.operate([](int &value) { value++; }); }
+        );
+        double recomputes_per_update = double(recomputes) / updates;
+        int last = properties.back()->get();
+        do_not_optimize(last);
+        destroy_backwards(properties);
+
+        report(
+                "property_lattice/" + std::to_string(depth), {
+                        {"depth", depth},
+                        {"ns_per_update", ns},
+                        {"recomputes_per_update", recomputes_per_update}
+                }
+        );
+        }
+
+    //every source feeds a running sum over the sources before it, all of them get written either one by
+    //one or inside a transaction
+    void measure_batch(std::size_t sources, bool transaction)
+        {
+        std::size_t recomputes = 0;
+        std::vector<std::unique_ptr<WProperty<int> > > properties;
+        for (std::size_t i = 0; i < sources; i++)
+            { properties.emplace_back(new WProperty<int>(0)); }
+        std::vector<std::unique_ptr<WProperty<int> > > sums;
+        for (std::size_t i = 0; i < sources; i++)
+            {
+            sums.emplace_back(
+                    new WProperty<int>(
+                            [&recomputes](int value, int previous)
+                                {
+                                recomputes++;
+                                return value + previous;
+                                }, *properties[i], i == 0 ? *properties[0] : *sums.back()
+                    )
+            );
+            }
+
+        auto write_all = [&]()
+            {
+            for (auto &property : properties)
+                { property->operate([](int &value) { value++; }); }
+            };
+        std::size_t updates = updates_for(sources * sources);
+        recomputes = 0;
+        double ns = ns_per_op(
+                updates, [&]()
+                    {
+                    if (transaction)
+                        {
+                        WPropertyTransaction batch;
+                        write_all();
+                        }
+                    else
+                        { write_all(); }
+                    }
+        );
+        double recomputes_per_batch = double(recomputes) / updates;
+        int last = sums.back()->get();
+        do_not_optimize(last);
+        destroy_backwards(sums);
+        destroy_backwards(properties);
+
+        report(
+                std::string(transaction ? "property_transaction/" : "property_unbatched/") +
+                std::to_string(sources), {
+                        {"sources", sources},
+                        {"ns_per_batch", ns},
+                        {"recomputes_per_batch", recomputes_per_batch}
+                }
+        );
+        }
+
+    //writes and reads of a property nothing depends on
+    void measure_scalar()
+        {
+        const std::size_t operations = 10000000;
+        WProperty<int> property(0);
+
+        std::size_t before = allocation_count();
+        int next = 0;
+        double write_ns = ns_per_op(
+                operations, [&]()
+                    { property = next++; }
+        );
+        std::size_t allocations = allocation_count() - before;
+
+        int sum = 0;
+        double read_ns = ns_per_op(
+                operations, [&]()
+                    {
+                    sum += property.get();
+                    do_not_optimize(sum);
+                    }
+        );
+
+        report(
+                "property_scalar", {
+                        {"ns_per_write", write_ns},
+                        {"ns_per_read", read_ns},
+                        {"allocations_per_write", double(allocations) / operations},
+                        {"bytes", sizeof(WProperty<int>)}
+                }
+        );
+        }
+
+    //a chain of length expressions below a source that keeps being written the value it already has
+    template<class Change>
+    void measure_noop_write(const std::string &policy, std::size_t length)
+        {
+        std::size_t recomputes = 0;
+        WProperty<int, Change> source(0);
+        std::vector<std::unique_ptr<WProperty<int, Change> > > properties;
+        for (std::size_t i = 0; i < length; i++)
+            {
+            auto recompute = [&recomputes](int value)
+                {
+                recomputes++;
+                return value;
+                };
+            if (properties.empty())
+                { properties.emplace_back(new WProperty<int, Change>(recompute, source)); }
+            else
+                { properties.emplace_back(new WProperty<int, Change>(recompute, *properties.back())); }
+            }
+
+        std::size_t updates = updates_for(length);
+        recomputes = 0;
+        double ns = ns_per_op(
+                updates, [&]()
+                    { source = 0; }
+        );
+        double recomputes_per_write = double(recomputes) / updates;
+        while (!properties.empty())
+            { properties.pop_back(); }
+
+        report(
+                "property_noop_write/" + policy + "/" + std::to_string(length), {
+                        {"length", length},
+                        {"ns_per_write", ns},
+                        {"recomputes_per_write", recomputes_per_write}
+                }
+        );
+        }
+
+    //the same chain as measure_chain with the expressions built as templates instead of std::function
+    void measure_template_chain(std::size_t length)
+        {
+        std::vector<std::unique_ptr<WProperty<int> > > properties;
+        properties.emplace_back(new WProperty<int>(0));
+        for (std::size_t i = 0; i < length; i++)
+            { properties.emplace_back(new WProperty<int>(*properties.back() + 1)); }
+
+        WProperty<int> &source = *properties.front();
+        std::size_t updates = updates_for(length);
+        double ns = ns_per_op(
+                updates, [&]()
+                    { source.operate([](int &value) { value++; }); }
+        );
+        int last = properties.back()->get();
+        do_not_optimize(last);
+        destroy_backwards(properties);
+
+        report(
+                "property_template_chain/" + std::to_string(length), {
+                        {"length", length},
+                        {"ns_per_update", ns},
+                        {"ns_per_node", ns / length}
+                }
+        );
+        }
+
+    //a + b * c evaluated written out, as a template and through std::function, without the binding
+    //and propagation around it
+    void measure_expression_evaluation()
+        {
+        const std::size_t evaluations = 50000000;
+        WProperty<int> a(1);
+        WProperty<int> b(2);
+        WProperty<int> c(3);
+        auto with_template = a + b * c;
+        auto with_function = make_expr(
+                std::function<int(int, int, int)>(
+                        [](int a, int b, int c)
+                            { return a + b * c; }
+                ), a, b, c
+        );
+
+        int sum = 0;
+        auto measure = [&](auto &&evaluate)
+            {
+            return ns_per_op(
+                    evaluations, [&]()
+                        {
+                        sum += evaluate();
+                        do_not_optimize(sum);
+                        }
+            );
+            };
+        double by_hand = measure([&]() { return a.get() + b.get() * c.get(); });
+        double expression = measure([&]() { return with_template.get(); });
+        double function = measure([&]() { return with_function.get(); });
+
+        report(
+                "property_expression_evaluation", {
+                        {"ns_by_hand", by_hand},
+                        {"ns_template", expression},
+                        {"ns_std_function", function}
+                }
+        );
+        }
+
+    //source <- a1 <- a2 <- ... <- aN, reads of aN and writes to the source
+    void measure_alias_chain(std::size_t length)
+        {
+        std::vector<std::unique_ptr<WProperty<int> > > properties;
+        properties.emplace_back(new WProperty<int>(0));
+        for (std::size_t i = 0; i < length; i++)
+            { properties.emplace_back(new WProperty<int>(*properties.back())); }
+
+        WProperty<int> &source = *properties.front();
+        WProperty<int> &alias = *properties.back();
+        const std::size_t reads = 10000000;
+        int sum = 0;
+        double read_ns = ns_per_op(
+                reads, [&]()
+                    {
+                    sum += alias.get();
+                    do_not_optimize(sum);
+                    }
+        );
+        std::size_t updates = updates_for(length);
+        double update_ns = ns_per_op(
+                updates, [&]()
+                    { source.operate([](int &value) { value++; }); }
+        );
+        destroy_backwards(properties);
+
+        report(
+                "property_alias_chain/" + std::to_string(length), {
+                        {"length", length},
+                        {"ns_per_read", read_ns},
+                        {"ns_per_update", update_ns}
+                }
+        );
+        }
+
+    //one source feeding width expressions that each take work iterations, recomputed on the writing
+    //thread or level by level on the shared pool
+    void measure_wide_level(std::size_t width, bool parallel)
+        {
+        const std::size_t work = 2000;
+        WProperty<double> source(0.0);
+        std::vector<std::unique_ptr<WProperty<double> > > properties;
+        for (std::size_t i = 0; i < width; i++)
+            {
+            properties.emplace_back(
+                    new WProperty<double>(
+                            make_expr(
+                                    [i, work](double value)
+                                        {
+                                        double result = 0;
+                                        for (std::size_t k = 0; k < work; k++)
+                                            { result += (value + double(i)) / double(k + 1); }
+                                        return result;
+                                        }, source
+                            )
+                    )
+            );
+            }
+
+        std::unique_ptr<WParallelPropagation> mode;
+        if (parallel)
+            { mode.reset(new WParallelPropagation()); }
+        std::size_t updates = 2000000 / (width * work) + 10;
+        double ns = ns_per_op(
+                updates, [&]()
+                    { source.operate([](double &value) { value++; }); }
+        );
+        mode.reset();
+        double last = properties.back()->get();
+        do_not_optimize(last);
+
+        report(
+                std::string(parallel ? "property_parallel_level/" : "property_serial_level/") +
+                std::to_string(width), {
+                        {"width", width},
+                        {"threads", parallel ? WThreadPool::shared().thread_count() : 1},
+                        {"ns_per_update", ns}
+                }
+        );
+        }
+    }
+
+WEVENTS_BENCHMARK(property_scalar)
+    { measure_scalar(); }
+
+WEVENTS_BENCHMARK(property_chain)
+    {
+    for (std::size_t length : {1, 16, 256})
+        { measure_chain(length); }
+    }
+
+WEVENTS_BENCHMARK(property_fan_out)
+    {
+    for (std::size_t width : {1, 16, 256})
+        { measure_fan_out(width); }
+    }
+
+WEVENTS_BENCHMARK(property_lattice)
+    {
+    for (std::size_t depth : {1, 8, 64})
+        { measure_lattice(depth); }
+    }
+
+WEVENTS_BENCHMARK(property_transaction)
+    {
+    for (std::size_t sources : {1, 8, 50})
+        {
+        measure_batch(sources, false);
+        measure_batch(sources, true);
+        }
+    }
+
+WEVENTS_BENCHMARK(property_noop_write)
+    {
+    for (std::size_t length : {1, 16, 256})
+        {
+        measure_noop_write<WChangeAlways>("always", length);
+        measure_noop_write<WChangeEqual>("equal", length);
+        measure_noop_write<WChangeFingerprint<> >("fingerprint", length);
+        }
+    }
+
+WEVENTS_BENCHMARK(property_template_chain)
+    {
+    for (std::size_t length : {1, 16, 256})
+        { measure_template_chain(length); }
+    }
+
+WEVENTS_BENCHMARK(property_expression_evaluation)
+    { measure_expression_evaluation(); }
+
+WEVENTS_BENCHMARK(property_alias_chain)
+    {
+    for (std::size_t length : {1, 16, 256})
+        { measure_alias_chain(length); }
+    }
+
+WEVENTS_BENCHMARK(property_parallel_level)
+    {
+    for (std::size_t width : {16, 256, 4096})
+        {
+        measure_wide_level(width, false);
+        measure_wide_level(width, true);
+        }
+    }
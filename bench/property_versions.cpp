@@ -0,0 +1,114 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "../src/w_property_versions.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+namespace
+    {
+    const std::size_t PROPERTIES = 16;
+    const std::size_t UPDATES = 200000;
+
+    //one property of PROPERTIES tracked ones written per update while readers keep taking snapshots
+    //and reading all of them
+    void measure_versions(std::size_t readers)
+        {
+        std::vector<std::unique_ptr<WProperty<int> > > properties;
+        WPropertyVersions versions;
+        std::vector<WVersionSlot<int> > slots;
+        for (std::size_t i = 0; i < PROPERTIES; i++)
+            {
+            properties.emplace_back(new WProperty<int>(0));
+            slots.push_back(versions.track(*properties.back()));
+            }
+
+        std::atomic<bool> stop(false);
+        std::atomic<std::size_t> snapshots(0);
+        std::vector<std::thread> threads;
+        for (std::size_t r = 0; r < readers; r++)
+            {
+            threads.emplace_back(
+                    [&]()
+                        {
+                        std::size_t taken = 0;
+                        while (!stop.load(std::memory_order_relaxed))
+                            {
+                            WPropertySnapshot snapshot = versions.snapshot();
+                            int sum = 0;
+                            for (const WVersionSlot<int> &slot : slots)
+                                { sum += snapshot.get(slot); }
+                            do_not_optimize(sum);
+                            taken++;
+                            }
+                        snapshots.fetch_add(taken);
+                        }
+            );
+            }
+
+        std::size_t next = 0;
+        auto start = std::chrono::steady_clock::now();
+        double write_ns = ns_per_op(
+                UPDATES, [&]()
+                    {
+                    *properties[next % PROPERTIES] = int(next);
+                    next++;
+                    }
+        );
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stop.store(true);
+        for (std::thread &thread : threads)
+            { thread.join(); }
+
+        report(
+                "property_versions/readers/" + std::to_string(readers), {
+                        {"readers", readers},
+                        {"ns_per_write_and_publish", write_ns},
+                        {"snapshots_per_second", snapshots.load() / seconds}
+                }
+        );
+        }
+
+    //what reading PROPERTIES values through a snapshot costs a single thread
+    void measure_snapshot()
+        {
+        std::vector<std::unique_ptr<WProperty<int> > > properties;
+        WPropertyVersions versions;
+        std::vector<WVersionSlot<int> > slots;
+        for (std::size_t i = 0; i < PROPERTIES; i++)
+            {
+            properties.emplace_back(new WProperty<int>(int(i)));
+            slots.push_back(versions.track(*properties.back()));
+            }
+
+        double ns = ns_per_op(
+                UPDATES * 10, [&]()
+                    {
+                    WPropertySnapshot snapshot = versions.snapshot();
+                    int sum = 0;
+                    for (const WVersionSlot<int> &slot : slots)
+                        { sum += snapshot.get(slot); }
+                    do_not_optimize(sum);
+                    }
+        );
+
+        report(
+                "property_versions/snapshot", {
+                        {"properties", PROPERTIES},
+                        {"ns_per_snapshot_and_read", ns}
+                }
+        );
+        }
+    }
+
+WEVENTS_BENCHMARK(property_versions)
+    {
+    measure_snapshot();
+    for (std::size_t readers : {0, 1, 2})
+        { measure_versions(readers); }
+    }
@@ -0,0 +1,200 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "histogram.h"
+#include "../src/w_event.h"
+
+using namespace wevents;
+using namespace wevents::bench;
+
+//producer threads emitting into a handful of shared signals whose connections are a mix of direct,
+//mutex guarded, thread pool and event loop ones, while other threads keep connecting and
+//disconnecting. run with the same settings for 1, 2, 4 ... up to max_threads producers to see where
+//throughput stops scaling and the tail latency blows up.
+//
+//  wevents_scaling [max_threads] [seconds_per_step]
+
+namespace
+    {
+    const std::size_t SIGNALS = 4;
+
+    std::uint64_t now_ns()
+        {
+        return std::uint64_t(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()
+                ).count()
+        );
+        }
+
+    class Service : public WSlotObject
+        {
+    public:
+        std::uint64_t total = 0;
+
+        void on_value(int value, std::uint64_t)
+            { total += value; }
+        };
+
+    struct Shared
+        {
+        WSignal<int, std::uint64_t> signals[SIGNALS];
+        std::mutex mutex;
+        Service guarded;
+        std::atomic<std::uint64_t> direct_total{0};
+        std::atomic<std::uint64_t> async_calls{0};
+        SharedHistogram delivery;
+        std::atomic<bool> running{true};
+        };
+
+    //time between the emit and the slot running on the pool or loop thread
+    void deliver(Shared &shared, std::uint64_t emitted)
+        {
+        shared.delivery.record(now_ns() - emitted);
+        shared.async_calls.fetch_add(1, std::memory_order_relaxed);
+        }
+
+    void connect_all(Shared &shared, WSignal<int, std::uint64_t> &signal, WThreadPool &pool, WEventLoop &loop)
+        {
+        Shared *state = &shared;
+        connect(
+                signal, [state](int value, std::uint64_t)
+                    { state->direct_total.fetch_add(value, std::memory_order_relaxed); }
+        );
+        connect(signal, &Service::on_value, &shared.guarded, ConOps().mutex(shared.mutex));
+        connect(
+                signal, [state](int, std::uint64_t emitted)
+                    { deliver(*state, emitted); }, ConOps().executor(pool)
+        );
+        connect(
+                signal, [state](int, std::uint64_t emitted)
+                    { deliver(*state, emitted); }, ConOps().queued(loop)
+        );
+        }
+
+    //returns the emit throughput so later steps can be compared to the single producer one
+    double run_step(std::size_t producers, double seconds, double baseline)
+        {
+        Shared shared;
+        WThreadPool pool(4, 1 << 16);
+        WEventLoop loop;
+        std::thread loop_thread([&loop]()
+            { loop.run(); });
+
+        for (std::size_t i = 0; i < SIGNALS; i++)
+            { connect_all(shared, shared.signals[i], pool, loop); }
+
+        std::vector<LocalHistogram> emit_latency(producers);
+        std::vector<std::uint64_t> emits(producers, 0);
+        std::vector<std::thread> threads;
+        std::atomic<std::size_t> ready(0);
+
+        for (std::size_t p = 0; p < producers; p++)
+            {
+            threads.emplace_back([&, p]()
+                {
+                ready.fetch_add(1);
+                WSignal<int, std::uint64_t> &signal = shared.signals[p % SIGNALS];
+                std::uint64_t count = 0;
+                while (shared.running.load(std::memory_order_relaxed))
+                    {
+                    std::uint64_t start = now_ns();
+                    signal.emit(1, start);
+                    emit_latency[p].record(now_ns() - start);
+                    count++;
+                    }
+                emits[p] = count;
+                });
+            }
+
+        //one churn thread per eight producers, each keeps a short lived subscription on every signal
+        std::size_t churners = producers / 8 + 1;
+        std::vector<std::uint64_t> churn(churners, 0);
+        for (std::size_t c = 0; c < churners; c++)
+            {
+            threads.emplace_back([&, c]()
+                {
+                Service subscriber;
+                std::uint64_t count = 0;
+                while (shared.running.load(std::memory_order_relaxed))
+                    {
+                    WSignal<int, std::uint64_t> &signal = shared.signals[count % SIGNALS];
+                    connect(signal, &Service::on_value, &subscriber).disconnect();
+                    count++;
+                    }
+                churn[c] = count;
+                });
+            }
+
+        while (ready.load() < producers)
+            { std::this_thread::yield(); }
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        shared.running.store(false);
+        for (std::thread &thread : threads)
+            { thread.join(); }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        //everything posted has to be delivered before the histograms are read
+        loop.execute([&loop]()
+            { loop.quit(); });
+        loop_thread.join();
+
+        LocalHistogram latency;
+        std::uint64_t total_emits = 0;
+        for (std::size_t p = 0; p < producers; p++)
+            {
+            latency.merge(emit_latency[p]);
+            total_emits += emits[p];
+            }
+        std::uint64_t total_churn = 0;
+        for (std::uint64_t count : churn)
+            { total_churn += count; }
+        while (shared.async_calls.load() < total_emits * 2)
+            { std::this_thread::yield(); }
+
+        double rate = total_emits / elapsed;
+        report(
+                "scaling/" + std::to_string(producers), {
+                        {"producers", producers},
+                        {"churn_threads", churners},
+                        {"emits_per_second", rate},
+                        {"speedup", baseline == 0 ? 1.0 : rate / baseline},
+                        {"emit_p50_ns", latency.percentile(0.5)},
+                        {"emit_p99_ns", latency.percentile(0.99)},
+                        {"emit_p999_ns", latency.percentile(0.999)},
+                        {"delivery_p50_ns", shared.delivery.percentile(0.5)},
+                        {"delivery_p99_ns", shared.delivery.percentile(0.99)},
+                        {"delivery_p999_ns", shared.delivery.percentile(0.999)},
+                        {"connect_disconnect_per_second", total_churn / elapsed},
+                        {"peak_loop_queue_depth", loop.stats().peak_pending}
+                }
+        );
+        return rate;
+        }
+    }
+
+int main(int argc, char **argv)
+    {
+    std::size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 0.5;
+
+    double baseline = 0;
+    for (std::size_t producers = 1; producers <= max_threads; producers *= 2)
+        {
+        std::fprintf(stderr, "running %zu producers\n", producers);
+        double rate = run_step(producers, seconds, baseline);
+        if (producers == 1)
+            { baseline = rate; }
+        }
+    print_results();
+    return 0;
+    }
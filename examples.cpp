@@ -7,21 +7,36 @@
 #include <chrono>
 #include <string>
 #include <thread>
+#include <atomic>
 
-#include "src/w_event(old).h"
+#include "src/w_event.h"
 #include "src/w_property.h"
+#include "src/w_property_array.h"
+#include "src/w_property_collection.h"
 
 using namespace wevents;
 using namespace std::chrono;
 
 std::mutex cout_mutex;
 
+int failures = 0;
+
+//prints what failed and keeps going so one run shows every broken check
+void check(bool passed, const char *what)
+    {
+    if (!passed)
+        {
+        std::cout << "check failed: " << what << std::endl;
+        failures++;
+        }
+    }
+
 void testWProperty()
     {
     //set some random values
     WProperty<int> value1(5);
     WProperty<int> value2(10);
-    WProperty<int> value3(15);
+    WProperty<int> *value3 = new WProperty<int>(15);
 
     //bind result1 property to expression involving value1 and value2
     WProperty<int> result1(
@@ -36,7 +51,7 @@ void testWProperty()
             [](int i1, int i2)
                 { return i1 + i2 - 20; },
             result1,
-            value3
+            *value3
     );
 
     std::cout << result2.get() << std::endl;
@@ -52,19 +67,21 @@ void testWProperty()
 
     //delete value3 to simulate object being destroyed
     //result2's binding to value3 handles the issue transparently
-    value3.~WProperty();
+    delete value3;
     result1 = 30;
     std::cout << result2.get() << std::endl;
     }
 
+//all of its slots run on the thread running its loop so i needs no mutex
 class SensativeDataClass : public WSlotObject
     {
 private:
     int i;
 
 public:
-    SensativeDataClass()
-            : i(0)
+    explicit SensativeDataClass(WEventLoop &loop)
+            : WSlotObject(loop),
+              i(0)
         {}
 
     int get() const
@@ -81,16 +98,75 @@ public:
             cout_mutex.unlock();
             }
         }
+    };
+
+WEventLoop data_loop;
+SensativeDataClass sensative_data_obj(data_loop);
+WSignal<const std::string&, int> inc_signal;
 
+void affine_signal_thread(std::string thread_name, int num)
+    {
+    inc_signal.emit(thread_name, num);
+
+    cout_mutex.lock();
+    std::cout << "executed imediatly after signal emit" << std::endl;
+    cout_mutex.unlock();
+    }
+
+void test_affine_event_handling()
+    {
+    //no ConOps given so the calls are routed to data_loop's thread
+    WConnection connection = connect(inc_signal, &SensativeDataClass::inc, &sensative_data_obj);
+
+    std::thread loop_thread([]() { data_loop.run(); });
+    std::thread th1(affine_signal_thread, "thread 1", 10);
+    std::thread th2(affine_signal_thread, "thread 2", 5);
+    th1.join();
+    th2.join();
+
+    //queued behind both emits so everything they posted is done when the loop stops
+    data_loop.execute([]() { data_loop.quit(); });
+    loop_thread.join();
+    connection.disconnect();
+
+    std::cout << "final value: " << sensative_data_obj.get() << std::endl;
+    }
+
+//the connections below lock its mutex around inc so i needs no event loop
+class LockedDataClass : public WSlotObject
+    {
+private:
+    int i;
+
+public:
     std::mutex mutex;
+
+    LockedDataClass()
+            : i(0)
+        {}
+
+    int get() const
+        { return i; }
+
+    void inc(const std::string& thread_name, int add)
+        {
+        for (int num = 0; num < add; num++)
+            {
+            i++;
+
+            cout_mutex.lock();
+            std::cout << thread_name << ": " << i << std::endl;
+            cout_mutex.unlock();
+            }
+        }
     };
 
-SensativeDataClass sensative_data_obj;
+LockedDataClass locked_data_obj;
 
 void blocking_mutex_signal_thread(std::string thread_name, int num)
     {
     WSignal<const std::string&, int> sig;
-    connect(sig, &SensativeDataClass::inc, &sensative_data_obj, ConOps().mutex(sensative_data_obj.mutex));
+    connect(sig, &LockedDataClass::inc, &locked_data_obj, ConOps().mutex(locked_data_obj.mutex));
     sig.emit(thread_name, num);
 
     cout_mutex.lock();
@@ -100,8 +176,10 @@ void blocking_mutex_signal_thread(std::string thread_name, int num)
 
 void nonblocking_mutex_signal_thread(std::string thread_name, int num)
     {
+    //the pool goes first and runs what is queued on it while sig is still connected
     WSignal<const std::string&, int> sig;
-    connect(sig, &SensativeDataClass::inc, &sensative_data_obj, ConOps().mutex(sensative_data_obj.mutex).blocking(false));
+    WThreadPool pool(1);
+    connect(sig, &LockedDataClass::inc, &locked_data_obj, ConOps().mutex(locked_data_obj.mutex).executor(pool));
     sig.emit(thread_name, num);
 
     cout_mutex.lock();
@@ -115,12 +193,360 @@ void test_mutex_event_handling()
     std::thread th2(blocking_mutex_signal_thread, "thread 2", 5);
     th1.join();
     th2.join();
+
+    check(locked_data_obj.get() == 15, "mutex connections from two threads lose no increments");
+    }
+
+void test_event_loop()
+    {
+    WEventLoop loop;
+    int total = 0;
+
+    //total is only ever touched by the thread running the loop so it needs no mutex
+    WSignal<int> sig;
+    connect(sig, [&total](int add) { total += add; }, ConOps().queued(loop));
+    connect(sig, [&loop, &total](int)
+        {
+        if (total >= 100)
+            { loop.quit(); }
+        }, ConOps().queued(loop));
+
+    std::thread producer([&sig]()
+        {
+        for (int i = 0; i < 10; i++)
+            { sig.emit(10); }
+        });
+
+    loop.run();
+    producer.join();
+
+    WEventLoopStats stats = loop.stats();
+    std::cout << "event loop total: " << total << " in " << stats.batches << " batches" << std::endl;
     }
 
+void test_lazy_evaluation()
+    {
+    WProperty<int> source(1);
+    int recomputes = 0;
+    WProperty<int> lazy(
+            [&recomputes](int value)
+                {
+                recomputes++;
+                return value * 10;
+                }, source
+    );
+    lazy.set_evaluation(WEvaluation::LAZY);
+    int invalidated = 0;
+    connect(lazy.onInvalidated, [&invalidated]() { invalidated++; });
+
+    recomputes = 0;
+    source = 2;
+    source = 3;
+    source = 4;
+    check(recomputes == 0, "lazy expression waits for a read");
+    check(invalidated == 3, "lazy property still invalidates on every change");
+    check(lazy.get() == 40, "lazy expression computes on read");
+    check(lazy.get() == 40 && recomputes == 1, "lazy expression computes once per change");
+    }
+
+//every path from a to d settles before d recomputes, so d never sees b and c from different changes
+void test_diamond()
+    {
+    WProperty<int> a(1);
+    WProperty<int> b([](int value) { return value + 1; }, a);
+    WProperty<int> c([](int value) { return value * 2; }, a);
+    int recomputes = 0;
+    bool consistent = true;
+    WProperty<int> d(
+            [&recomputes, &consistent](int x, int y)
+                {
+                recomputes++;
+                consistent = consistent && y == (x - 1) * 2;
+                return x + y;
+                }, b, c
+    );
+    std::vector<int> seen;
+    connect(d.onChanged, [&seen](const int &value) { seen.push_back(value); });
+
+    recomputes = 0;
+    a = 5;
+    check(recomputes == 1, "diamond recomputes once per change");
+    check(consistent, "diamond never mixes old and new inputs");
+    check(seen.size() == 1 && seen[0] == 16, "diamond notifies once with the settled value");
+    }
+
+void test_transactions()
+    {
+    WProperty<int> x(1);
+    WProperty<int> y(2);
+    int recomputes = 0;
+    WProperty<int> sum(
+            [&recomputes](int i, int j)
+                {
+                recomputes++;
+                return i + j;
+                }, x, y
+    );
+    int notified = 0;
+    connect(sum.onChanged, [&notified](const int &) { notified++; });
+
+    recomputes = 0;
+    {
+    WPropertyTransaction batch;
+    x = 10;
+    y = 20;
+    check(notified == 0, "transaction holds notifications back");
+    check(sum.get() == 30, "reads inside a transaction see the current inputs");
+    }
+    check(notified == 1, "transaction notifies once on commit");
+    check(sum.get() == 30, "transaction result");
+    check(recomputes <= 2, "transaction recomputes once, plus the read inside it");
+
+    //the held propagation still lists a property deleted before the commit
+    {
+    WPropertyTransaction batch;
+    WProperty<int> *doomed = new WProperty<int>(1);
+    WProperty<int> dependent([](int value) { return value * 2; }, *doomed);
+    *doomed = 2;
+    x = 3;
+    delete doomed;
+    }
+    check(sum.get() == 23 && notified == 2, "property deleted inside a transaction drops out of it");
+    }
+
+void test_change_policies()
+    {
+    WProperty<int, WChangeEqual> equal(1);
+    int recomputes = 0;
+    WProperty<int> doubled(
+            [&recomputes](int value)
+                {
+                recomputes++;
+                return value * 2;
+                }, equal
+    );
+    int notified = 0;
+    connect(equal.onChanged, [&notified](const int &) { notified++; });
+
+    recomputes = 0;
+    equal = 1;
+    check(notified == 0 && recomputes == 0, "WChangeEqual drops a write of the same value");
+    equal = 2;
+    check(notified == 1 && recomputes == 1 && doubled.get() == 4, "WChangeEqual passes a new value");
+
+    WProperty<std::string, WChangeFingerprint<> > text(std::string("abc"));
+    int edits = 0;
+    connect(text.onInvalidated, [&edits]() { edits++; });
+    text.operate([](std::string &value) { value = "abc"; });
+    check(edits == 0, "WChangeFingerprint drops an edit that restores the value");
+    text.operate([](std::string &value) { value += "d"; });
+    check(edits == 1, "WChangeFingerprint catches an in place edit");
+
+    WProperty<int> always(1);
+    int writes = 0;
+    connect(always.onInvalidated, [&writes]() { writes++; });
+    always = 1;
+    check(writes == 1, "WChangeAlways notifies every write");
+    }
+
+void test_expressions()
+    {
+    WProperty<int> price(3);
+    WProperty<int> quantity(4);
+    WProperty<int> shipping(5);
+    WProperty<int> total = price * quantity + shipping;
+    WProperty<double> scaled = make_expr([](int t, double k) { return t * k; }, total, 0.5);
+
+    check(total.get() == 17 && scaled.get() == 8.5, "expression computes from its inputs");
+    quantity = 10;
+    check(total.get() == 35 && scaled.get() == 17.5, "expression follows its inputs");
+    total = 1;
+    quantity = 20;
+    check(total.get() == 1 && scaled.get() == 0.5, "writing an expression property drops the expression");
+    }
+
+void test_aliases()
+    {
+    WProperty<int> a(1);
+    WProperty<int> b(2);
+    WProperty<int> first(a);
+    WProperty<int> second(first);
+    int notified = 0;
+    connect(second.onChanged, [&notified](const int &) { notified++; });
+
+    check(second.get() == 1, "alias chain reads the end of the chain");
+    a = 5;
+    check(second.get() == 5 && notified == 1, "alias chain follows the end of the chain");
+    first = b;
+    check(second.get() == 2 && notified == 2, "alias moves over when the middle of the chain is rebound");
+    b = 7;
+    check(second.get() == 7, "rebound alias follows its new end");
+    a = 8;
+    check(second.get() == 7 && notified == 3, "rebound alias ignores its old end");
+    first = 10;
+    check(second.get() == 10, "alias follows a link assigned a value");
+    }
+
+void test_arrays()
+    {
+    WPropertyArray<float> positions(4, 1.0f);
+    WPropertyArray<float> offsets(4, 2.0f);
+    WProperty<float> scale(3.0f);
+    WPropertyArray<float> scaled = positions * scale + offsets;
+    std::vector<std::size_t> touched;
+    connect(scaled.onChanged, [&touched](const std::vector<std::size_t> &indices) { touched = indices; });
+
+    check(scaled.get(0) == 5.0f && scaled.get(3) == 5.0f, "array expression computes every element");
+    positions.set(2, 2.0f);
+    check(scaled.get(2) == 8.0f && scaled.get(1) == 5.0f, "array expression recomputes the changed element");
+    check(touched == std::vector<std::size_t>{2}, "array reports only the changed index");
+    scale = 1.0f;
+    check(scaled.get(0) == 3.0f && scaled.get(2) == 4.0f, "a scalar input applies to every element");
+    check(touched.size() == 4, "a scalar change touches every element");
+    }
+
+void test_collection_deltas()
+    {
+    WPropertyVector<int> vector;
+    std::vector<WVectorChange<int> > changes;
+    connect(vector.onChanged, [&changes](const std::vector<WVectorChange<int> > &settled) { changes = settled; });
+
+    {
+    WPropertyTransaction batch;
+    vector.push_back(1);
+    vector.push_back(2);
+    vector.push_back(3);
+    }
+    check(changes.size() == 1 && changes[0].kind == WVectorChange<int>::INSERTED &&
+          changes[0].index == 0 && changes[0].values == std::vector<int>({1, 2, 3}),
+          "consecutive inserts merge into one delta");
+    vector.set(1, 20);
+    check(changes.size() == 1 && changes[0].kind == WVectorChange<int>::UPDATED && changes[0].index == 1 &&
+          changes[0].previous == std::vector<int>({2}) && changes[0].values == std::vector<int>({20}),
+          "update delta carries the old and new value");
+    vector.erase(0, 2);
+    check(changes.size() == 1 && changes[0].kind == WVectorChange<int>::ERASED &&
+          changes[0].previous == std::vector<int>({1, 20}), "erase delta carries the erased values");
+
+    WPropertyVector<int> source(std::vector<int>{1, 2, 3, 4, 5, 6});
+    WPropertyVector<int> even = filtered(source, [](int value) { return value % 2 == 0; });
+    WPropertyVector<int> ordered = sorted(source, std::greater<int>());
+    std::vector<WVectorChange<int> > filtered_changes;
+    connect(even.onChanged, [&filtered_changes](const std::vector<WVectorChange<int> > &settled) { filtered_changes = settled; });
+    source.set(0, 8);
+    check(even.values() == std::vector<int>({8, 2, 4, 6}), "filtered vector takes in an element that starts passing");
+    check(filtered_changes.size() == 1 && filtered_changes[0].kind == WVectorChange<int>::INSERTED &&
+          filtered_changes[0].index == 0, "filtered vector reports only its own delta");
+    check(ordered.values() == std::vector<int>({8, 6, 5, 4, 3, 2}), "sorted vector moves an updated element");
+
+    WPropertyMap<std::string, int> map;
+    std::vector<WMapChange<std::string, int> > map_changes;
+    connect(map.onChanged, [&map_changes](const std::vector<WMapChange<std::string, int> > &settled) { map_changes = settled; });
+    map.set("a", 1);
+    map.set("a", 2);
+    check(map_changes.size() == 1 && map_changes[0].kind == WMapChange<std::string, int>::UPDATED &&
+          map_changes[0].previous == 1 && map_changes[0].value == 2, "map update delta carries the old and new value");
+    WProperty<int> map_total = summed(map);
+    map.set("b", 5);
+    check(map_total.get() == 7, "map fold follows an insert");
+    map.erase("a");
+    check(map_total.get() == 5, "map fold follows an erase");
+    }
+
+void test_collection_folds()
+    {
+    WPropertyVector<int> vector;
+    vector.push_back(1);
+    vector.push_back(2);
+    vector.push_back(3);
+
+    //the fold starts from the vector as it is when bound, not when the expression was made
+    auto sum = summed(vector);
+    check(sum.get() == 6, "unbound fold reads the vector");
+    vector.push_back(10);
+    check(sum.get() == 16, "unbound fold sees later changes");
+    WProperty<int> total = sum;
+    check(total.get() == 16, "fold bound after a change includes it");
+
+    vector.erase(0);
+    check(total.get() == 15, "bound fold follows an erase");
+    vector.set(0, 20);
+    check(total.get() == 33, "bound fold follows an update");
+    }
+
+class DisconnectTarget : public WSlotObject
+    {
+public:
+    void hit(int)
+        {}
+    };
+
+//one thread disconnects while another deletes either end of the connection
+void test_disconnect_races()
+    {
+    bool disconnected = true;
+    for (int i = 0; i < 2000; i++)
+        {
+        WSignal<int> *signal = new WSignal<int>();
+        DisconnectTarget *target = new DisconnectTarget();
+        WConnection connection = connect(*signal, &DisconnectTarget::hit, target);
+        std::atomic<bool> ready(false);
+        std::thread disconnecter([connection, &ready]()
+            {
+            ready = true;
+            connection.disconnect();
+            });
+        while (!ready)
+            { std::this_thread::yield(); }
+        if (i % 2 == 0)
+            {
+            delete target;
+            disconnecter.join();
+            delete signal;
+            }
+        else
+            {
+            delete signal;
+            disconnecter.join();
+            delete target;
+            }
+        disconnected = disconnected && !connection.connected();
+        }
+    check(disconnected, "connection is gone after racing disconnect and delete");
+    }
+
+//calls still queued when a loop goes away are dropped, not run on the destroying thread
+void test_dropped_tasks()
+    {
+    int calls = 0;
+    WSignal<int> sig;
+    {
+    WEventLoop loop;
+    connect(sig, [&calls](int) { calls++; }, ConOps().queued(loop));
+    sig.emit(1);
+    sig.emit(2);
+    }
+    check(calls == 0, "destroyed event loop drops its queued calls");
+    }
 
 int main()
     {
-    test_mutex_event_handling(); //this test segfaults a lot
+    testWProperty();
+    test_affine_event_handling();
+    test_mutex_event_handling();
+    test_event_loop();
+
+    test_lazy_evaluation();
+    test_diamond();
+    test_transactions();
+    test_change_policies();
+    test_expressions();
+    test_aliases();
+    test_arrays();
+    test_collection_deltas();
+    test_collection_folds();
+    test_disconnect_races();
+    test_dropped_tasks();
 
-    return 0;
+    return failures == 0 ? 0 : 1;
     }
@@ -0,0 +1,241 @@
+#ifndef WEVENTS_W_EPOCH_H
+#define WEVENTS_W_EPOCH_H
+
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace wevents
+    {
+    namespace internal
+        {
+        //epoch based reclamation. readers enter a Guard before loading a shared pointer and
+        //writers retire() whatever they unlinked instead of deleting it. retired objects are only
+        //freed once every thread that could still be looking at them has left its guard
+        namespace epoch
+            {
+            struct Retired
+                {
+                void *ptr;
+                void (*deleter)(void *);
+                std::uint64_t epoch;
+                };
+
+            struct ThreadRecord
+                {
+                std::atomic<std::uint64_t> announced;
+                std::atomic<bool> in_use;
+                ThreadRecord *next;
+                unsigned nesting;
+                bool collecting;
+                std::vector<Retired> retired;
+                std::vector<Retired> expired;
+
+                ThreadRecord()
+                        : announced(0),
+                          in_use(true),
+                          next(nullptr),
+                          nesting(0),
+                          collecting(false)
+                    {}
+                };
+
+            class Domain
+                {
+            private:
+                static const std::size_t COLLECT_THRESHOLD = 32;
+
+                std::atomic<std::uint64_t> global_epoch;
+                std::atomic<ThreadRecord *> records;
+
+                std::mutex orphans_mutex;
+                std::vector<Retired> orphans;
+
+                bool try_advance()
+                    {
+                    std::uint64_t current = global_epoch.load(std::memory_order_seq_cst);
+                    for (ThreadRecord *record = records.load(std::memory_order_acquire);
+                         record != nullptr;
+                         record = record->next)
+                        {
+                        std::uint64_t announced = record->announced.load(std::memory_order_seq_cst);
+                        if (announced != 0 && announced != current)
+                            { return false; }
+                        }
+                    return global_epoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+                    }
+
+                //deleters may retire more objects into the same list so the expired ones are pulled out first
+                static void free_expired(std::vector<Retired> &list, std::vector<Retired> &expired, std::uint64_t current)
+                    {
+                    expired.clear();
+                    std::size_t kept = 0;
+                    for (std::size_t i = 0; i < list.size(); i++)
+                        {
+                        if (list[i].epoch + 2 <= current)
+                            { expired.push_back(list[i]); }
+                        else
+                            { list[kept++] = list[i]; }
+                        }
+                    list.resize(kept);
+                    for (Retired &retired : expired)
+                        { retired.deleter(retired.ptr); }
+                    expired.clear();
+                    }
+
+            public:
+                Domain()
+                        : global_epoch(1),
+                          records(nullptr)
+                    {}
+
+                ThreadRecord *acquire_record()
+                    {
+                    for (ThreadRecord *record = records.load(std::memory_order_acquire);
+                         record != nullptr;
+                         record = record->next)
+                        {
+                        bool expected = false;
+                        if (!record->in_use.load(std::memory_order_relaxed)
+                            && record->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                            { return record; }
+                        }
+
+                    ThreadRecord *record = new ThreadRecord();
+                    ThreadRecord *head = records.load(std::memory_order_relaxed);
+                    do
+                        { record->next = head; }
+                    while (!records.compare_exchange_weak(head, record, std::memory_order_release));
+                    return record;
+                    }
+
+                //anything the exiting thread could not free yet is handed to whoever collects next
+                void release_record(ThreadRecord *record)
+                    {
+                    {
+                        std::lock_guard<std::mutex> lock(orphans_mutex);
+                        orphans.insert(orphans.end(), record->retired.begin(), record->retired.end());
+                    }
+                    record->retired.clear();
+                    record->in_use.store(false, std::memory_order_release);
+                    }
+
+                void enter(ThreadRecord *record)
+                    {
+                    if (record->nesting++ == 0)
+                        {
+                        record->announced.store(global_epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        }
+                    }
+
+                void leave(ThreadRecord *record)
+                    {
+                    if (--record->nesting == 0)
+                        { record->announced.store(0, std::memory_order_release); }
+                    }
+
+                void retire(ThreadRecord *record, void *ptr, void (*deleter)(void *))
+                    {
+                    record->retired.push_back({ptr, deleter, global_epoch.load(std::memory_order_seq_cst)});
+                    if (record->retired.size() >= COLLECT_THRESHOLD && !record->collecting)
+                        { collect(record); }
+                    }
+
+                void collect(ThreadRecord *record)
+                    {
+                    record->collecting = true;
+                    try_advance();
+                    std::uint64_t current = global_epoch.load(std::memory_order_seq_cst);
+                    free_expired(record->retired, record->expired, current);
+
+                    std::unique_lock<std::mutex> lock(orphans_mutex, std::try_to_lock);
+                    if (lock.owns_lock() && !orphans.empty())
+                        { free_expired(orphans, record->expired, current); }
+                    record->collecting = false;
+                    }
+                };
+
+            //never destroyed so that signals living in other static objects can still retire into it
+            inline Domain &domain()
+                {
+                static Domain *instance = new Domain();
+                return *instance;
+                }
+
+            inline ThreadRecord *&local_record_slot()
+                {
+                static thread_local ThreadRecord *record = nullptr;
+                return record;
+                }
+
+            class ThreadHandle
+                {
+            public:
+                ~ThreadHandle()
+                    {
+                    ThreadRecord *&record = local_record_slot();
+                    if (record != nullptr)
+                        {
+                        domain().release_record(record);
+                        record = nullptr;
+                        }
+                    }
+                };
+
+            //a thread that still emits after its handle was torn down just keeps the record it gets then
+            inline ThreadRecord *local_record()
+                {
+                ThreadRecord *&record = local_record_slot();
+                if (record == nullptr)
+                    {
+                    static thread_local ThreadHandle handle;
+                    record = domain().acquire_record();
+                    }
+                return record;
+                }
+
+            class Guard
+                {
+            private:
+                ThreadRecord *record;
+
+            public:
+                Guard()
+                        : record(local_record())
+                    { domain().enter(record); }
+
+                ~Guard()
+                    { domain().leave(record); }
+
+                Guard(const Guard &) = delete;
+                Guard &operator=(const Guard &) = delete;
+                };
+
+            template<class T>
+            void retire(T *ptr)
+                {
+                domain().retire(
+                        local_record(), ptr, [](void *p)
+                            { delete static_cast<T *>(p); }
+                );
+                }
+
+            inline void retire(void *ptr, void (*deleter)(void *))
+                { domain().retire(local_record(), ptr, deleter); }
+
+            //frees what this thread retired that no guard can see anymore without waiting for
+            //COLLECT_THRESHOLD retirements, for owners that retire rarely but hold large objects
+            inline void collect()
+                {
+                ThreadRecord *record = local_record();
+                if (!record->collecting)
+                    { domain().collect(record); }
+                }
+            }
+        }
+    }
+
+#endif //WEVENTS_W_EPOCH_H
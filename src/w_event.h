@@ -17,8 +17,18 @@
 #include <type_traits>
 #include <mutex>
 #include <thread>
-#include <tuple>
-#include <experimental/tuple>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "w_function.h"
+#include "w_executor.h"
+#include "w_event_loop.h"
+#include "w_epoch.h"
+#include "w_pool.h"
+#include "w_instrument.h"
+#include "w_trace.h"
 
 namespace wevents
     {
@@ -27,346 +37,646 @@ namespace wevents
 
     class WSlotObject;
 
+    //plain value describing how a connection gets invoked. with no flags set the slot is simply called
+    //on the emitting thread which is what the dispatch path checks first
+    class ConOps
+        {
+    public:
+        enum Flags
+            {
+            LOCKED = 1 << 0,
+            ASYNC = 1 << 1,
+            QUEUED = 1 << 2,
+            AFFINE = 1 << 3,
+            };
+
+    private:
+        std::mutex *mutexPtr;
+        WExecutor *executorPtr;
+        unsigned char flags;
+
+    public:
+        ConOps()
+                : mutexPtr(nullptr),
+                  executorPtr(nullptr),
+                  flags(0)
+            {}
+
+        ConOps &blocking(bool value)
+            {
+            if (value)
+                {
+                executorPtr = nullptr;
+                flags &= ~(ASYNC | QUEUED | AFFINE);
+                }
+            else
+                { executor(WThreadPool::shared()); }
+            return *this;
+            }
+
+        ConOps &executor(WExecutor &executor)
+            {
+            executorPtr = &executor;
+            flags = (flags & ~(QUEUED | AFFINE)) | ASYNC;
+            return *this;
+            }
+
+        //every call is posted to the loop and runs on the thread draining it, even when the signal
+        //is emitted on that same thread
+        ConOps &queued(WEventLoop &loop)
+            {
+            executorPtr = &loop;
+            flags = (flags & ~AFFINE) | ASYNC | QUEUED;
+            return *this;
+            }
+
+        //called right away when emitted on the thread running the loop, posted to the loop otherwise
+        ConOps &affine(WEventLoop &loop)
+            {
+            executorPtr = &loop;
+            flags = (flags & ~QUEUED) | ASYNC | AFFINE;
+            return *this;
+            }
+
+        ConOps &mutex(std::mutex &mutex)
+            {
+            mutexPtr = &mutex;
+            flags |= LOCKED;
+            return *this;
+            }
+
+        bool is_direct() const
+            { return flags == 0; }
+
+        bool is_blocking() const
+            { return (flags & ASYNC) == 0; }
+
+        bool is_queued() const
+            { return (flags & QUEUED) != 0; }
+
+        bool is_affine() const
+            { return (flags & AFFINE) != 0; }
+
+        bool has_mutex() const
+            { return (flags & LOCKED) != 0; }
+
+        std::mutex *get_mutex() const
+            { return mutexPtr; }
+
+        WExecutor *get_executor() const
+            { return executorPtr; }
+        };
+
     namespace internal
         {
         namespace events
             {
-            class MutexActions;
-
-            class ThreadActions;
+            class ConnectionBase;
             }
         }
 
-    class ConOps
+    //what connect() returns. just a slot index and the generation that slot had when the connection
+    //was made, so it is trivially copyable and a handle to a connection that is already gone is
+    //recognised as stale instead of touching freed memory
+    class WConnection
         {
     private:
-        internal::events::MutexActions *mutexActions;
-        internal::events::ThreadActions *threadActions;
+        friend class internal::events::ConnectionBase;
+
+        std::uint32_t index;
+        std::uint32_t generation;
 
-        void release_resources();
+        WConnection(std::uint32_t index, std::uint32_t generation)
+                : index(index),
+                  generation(generation)
+            {}
 
     public:
-        ConOps();
+        WConnection()
+                : index(0),
+                  generation(0)
+            {}
 
-        ~ConOps()
-            { release_resources(); }
+        bool connected() const;
 
-        ConOps(const ConOps &copy);
+        //returns false if the connection was already gone
+        bool disconnect() const;
 
-        ConOps(ConOps &&copy)
-                : mutexActions(copy.mutexActions),
-                  threadActions(copy.threadActions)
-            {
-            copy.mutexActions = nullptr;
-            copy.threadActions = nullptr;
-            }
+        void operator()() const
+            { disconnect(); }
+
+        bool operator==(const WConnection &other) const
+            { return index == other.index && generation == other.generation; }
+
+        bool operator!=(const WConnection &other) const
+            { return !(*this == other); }
+        };
+
+    //disconnects when it goes out of scope
+    class WScopedConnection
+        {
+    private:
+        WConnection connection;
+
+    public:
+        WScopedConnection()
+            {}
+
+        WScopedConnection(WConnection connection)
+                : connection(connection)
+            {}
 
-        ConOps &operator=(const ConOps &copy);
+        WScopedConnection(WScopedConnection &&other)
+                : connection(other.release())
+            {}
 
-        ConOps &operator=(ConOps &&copy)
+        WScopedConnection &operator=(WScopedConnection &&other)
             {
-            release_resources();
-            mutexActions = copy.mutexActions;
-            threadActions = copy.threadActions;
-            copy.mutexActions = nullptr;
-            copy.threadActions = nullptr;
+            if (this != &other)
+                {
+                connection.disconnect();
+                connection = other.release();
+                }
             return *this;
             }
 
-        ConOps &blocking(bool value);
+        WScopedConnection(const WScopedConnection &) = delete;
+        WScopedConnection &operator=(const WScopedConnection &) = delete;
 
-        ConOps &mutex(std::mutex &mutex);
+        ~WScopedConnection()
+            { connection.disconnect(); }
 
-        bool is_blocking() const
-            { return threadActions == nullptr; }
+        WConnection get() const
+            { return connection; }
 
-        bool has_mutex() const
-            { return mutexActions == nullptr; }
+        //hands the connection back without disconnecting it
+        WConnection release()
+            {
+            WConnection released = connection;
+            connection = WConnection();
+            return released;
+            }
 
-        internal::events::ThreadActions &get_thread_actions()
-            { return *threadActions; }
+        bool connected() const
+            { return connection.connected(); }
 
-        internal::events::MutexActions &get_mutex()
-            { return *mutexActions; }
+        void disconnect()
+            {
+            connection.disconnect();
+            connection = WConnection();
+            }
         };
 
     namespace internal
         {
         namespace events
             {
-            class ConnectionBase
+            //process wide table that WConnection handles index into. it lives outside any one signal so a
+            //handle can still be checked after its signal was destroyed, a slot's generation is bumped every
+            //time its connection goes away and slots are never freed, only reused
+            class SlotTable
                 {
             public:
-                enum States
+                struct Slot
                     {
-                    DEFAULT,
-                    RUNNING,
-                    DELETE_SELF,
+                    std::atomic<std::uint32_t> generation;
+                    std::uint32_t next_free;
+                    std::atomic<ConnectionBase *> connection;
+
+                    Slot()
+                            : generation(1),
+                              next_free(0),
+                              connection(nullptr)
+                        {}
                     };
 
             private:
-                States state;
-                ConOps options;
-
-            protected:
-                ConnectionBase(ConOps &&options)
-                        : options(options),
-                          state(ConnectionBase::DEFAULT)
-                    {}
+                static const std::uint32_t CHUNK_BITS = 14;
+                static const std::uint32_t CHUNK_SIZE = 1 << CHUNK_BITS;
+                static const std::uint32_t MAX_CHUNKS = 1 << 14;
+                static const std::uint32_t NONE = 0xffffffff;
+                static const std::uint32_t SATURATED = 0xffffffff;
+
+                std::atomic<Slot *> chunks[MAX_CHUNKS];
+                std::uint32_t chunk_count;
+                std::uint32_t free_head;
+                std::mutex mutex;
+
+                //every slot of a full table is connected or saturated
+                void grow()
+                    {
+                    if (chunk_count == MAX_CHUNKS)
+                        { throw std::length_error("WConnection slot table is full"); }
+                    Slot *chunk = new Slot[CHUNK_SIZE];
+                    std::uint32_t first = chunk_count * CHUNK_SIZE;
+                    for (std::uint32_t i = 0; i < CHUNK_SIZE; i++)
+                        { chunk[i].next_free = i + 1 < CHUNK_SIZE ? first + i + 1 : NONE; }
+                    chunks[chunk_count].store(chunk, std::memory_order_release);
+                    chunk_count++;
+                    free_head = first;
+                    }
 
             public:
-                virtual ~ConnectionBase()
-                    {}
+                SlotTable()
+                        : chunk_count(0),
+                          free_head(NONE)
+                    {
+                    for (std::uint32_t i = 0; i < MAX_CHUNKS; i++)
+                        { chunks[i].store(nullptr, std::memory_order_relaxed); }
+                    }
 
-                ConOps &get_options()
-                    { return options; }
+                Slot &get(std::uint32_t index)
+                    { return chunks[index >> CHUNK_BITS].load(std::memory_order_acquire)[index & (CHUNK_SIZE - 1)]; }
 
-                void set_state(States state)
-                    { this->state = state; }
+                std::uint32_t acquire(ConnectionBase *connection)
+                    {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (free_head == NONE)
+                        { grow(); }
+                    std::uint32_t index = free_head;
+                    Slot &slot = get(index);
+                    free_head = slot.next_free;
+                    slot.connection.store(connection, std::memory_order_release);
+                    return index;
+                    }
 
-                States get_state() const
-                    { return state; }
+                //a slot whose generation ran up to the last value is never handed out again, so generations
+                //never wrap back to 0, which marks an empty handle, or to one a stale handle still holds
+                void release(std::uint32_t index)
+                    {
+                    Slot &slot = get(index);
+                    std::uint32_t generation = slot.generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+                    slot.connection.store(nullptr, std::memory_order_release);
+                    if (generation == SATURATED)
+                        { return; }
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    slot.next_free = free_head;
+                    free_head = index;
+                    }
                 };
 
-            template<class... Args>
-            class Connection;
-
-            inline void register_connection(WSlotObject *object, ConnectionBase *ptr);
-            inline void unregister_connection(WSlotObject *object, ConnectionBase *ptr);
-
-            class MutexActions
+            //never destroyed so handles held by static objects stay checkable
+            inline SlotTable &slot_table()
                 {
-            public:
-                virtual void execute(std::function<void()> code) = 0;
-                virtual MutexActions *clone() = 0;
-                };
+                static SlotTable *instance = new SlotTable();
+                return *instance;
+                }
 
-            class Mutex : public MutexActions
+            class ConnectionBase : public pool::Pooled
                 {
             private:
-                std::mutex *mutex;
+                std::atomic<std::size_t> references;
+                std::atomic<bool> connected;
+                std::uint32_t slot_index;
+                std::uint32_t slot_generation;
+                ConOps options;
+#ifdef WEVENTS_INSTRUMENTATION
+                instrument::ConnectionCounters *counters;
+#endif
 
-            public:
-                Mutex(std::mutex &mutex)
-                        : mutex(&mutex)
+            protected:
+                ConnectionBase(ConOps &&options)
+                        : references(1),
+                          connected(true),
+                          slot_index(slot_table().acquire(this)),
+                          slot_generation(slot_table().get(slot_index).generation.load(std::memory_order_relaxed)),
+                          options(std::move(options))
+#ifdef WEVENTS_INSTRUMENTATION
+                        , counters(new instrument::ConnectionCounters())
+#endif
                     {}
 
-                void execute(std::function<void()> code)
+                virtual void unregister() = 0;
+
+            public:
+                virtual ~ConnectionBase()
                     {
-                    mutex->lock();
-                    code();
-                    mutex->unlock();
+#ifdef WEVENTS_INSTRUMENTATION
+                    delete counters;
+#endif
                     }
 
-                MutexActions *clone()
-                    { return new Mutex(*mutex); }
-                };
+#ifdef WEVENTS_INSTRUMENTATION
+                instrument::ConnectionCounters *get_counters() const
+                    { return counters; }
+#endif
 
-            class NoMutex : public MutexActions
-                {
-            public:
-                void execute(std::function<void()> code)
-                    {}
+                ConOps &get_options()
+                    { return options; }
 
-                MutexActions *clone()
-                    { return new NoMutex(); }
-                };
+                bool is_connected() const
+                    { return connected.load(std::memory_order_acquire); }
 
-            class ThreadActions
-                {
-            public:
-                virtual void execute(std::function<void()> code, ConnectionBase *conn) = 0;
-                virtual ThreadActions *clone() = 0;
-                };
+                void retain()
+                    { references.fetch_add(1, std::memory_order_relaxed); }
 
-            class Thread : public ThreadActions
-                {
-            public:
-                Thread()
-                    {}
+                void release()
+                    {
+                    if (references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        { delete this; }
+                    }
+
+                WConnection handle() const
+                    { return WConnection(slot_index, slot_generation); }
 
-                void execute(std::function<void()> code, ConnectionBase *conn)
+                //detaches the connection and drops the owners reference once no emit can still be
+                //walking over it, calls still sitting in an executor queue keep it alive until they are done.
+                //returns false if somebody else already destroyed it, that thread may still be unregistering
+                bool destroy()
                     {
-                    conn->set_state(ConnectionBase::RUNNING);
-                    std::thread thread(
-                            [&, conn]()
-                                {
-                                code();
-                                switch (conn->get_state())
-                                    {
-                                    case ConnectionBase::RUNNING:
-                                        conn->set_state(ConnectionBase::DEFAULT);
-                                        break;
-                                    case ConnectionBase::DELETE_SELF:
-                                        delete conn;
-                                        break;
-                                    default:
-                                        break;
-                                    }
-                                }
+                    if (!connected.exchange(false, std::memory_order_acq_rel))
+                        { return false; }
+                    slot_table().release(slot_index);
+                    unregister();
+                    epoch::retire(
+                            this, [](void *ptr)
+                                { static_cast<ConnectionBase *>(ptr)->release(); }
                     );
-                    thread.detach();
+                    return true;
                     }
-
-                ThreadActions *clone()
-                    { return new Thread(); }
                 };
 
-            class NoThread : public ThreadActions
-                {
-            public:
-                NoThread()
-                    {}
-
-                void execute(std::function<void()> code, ConnectionBase *conn)
-                    { code(); }
+            template<class... Args>
+            class Connection;
 
-                ThreadActions *clone()
-                    { return new NoThread(); }
-                };
+            inline void register_connection(WSlotObject *object, ConnectionBase *ptr);
+            inline void unregister_connection(WSlotObject *object, ConnectionBase *ptr);
             }
         }
 
+    inline bool WConnection::connected() const
+        {
+        if (generation == 0)
+            { return false; }
+        return internal::events::slot_table().get(index).generation.load(std::memory_order_acquire) == generation;
+        }
+
+    inline bool WConnection::disconnect() const
+        {
+        if (generation == 0)
+            { return false; }
+
+        //the connection pointer is only trusted if the generation still matches after reading it,
+        //the guard keeps it from being freed in between
+        internal::epoch::Guard guard;
+        internal::events::SlotTable::Slot &slot = internal::events::slot_table().get(index);
+        if (slot.generation.load(std::memory_order_acquire) != generation)
+            { return false; }
+        internal::events::ConnectionBase *connection = slot.connection.load(std::memory_order_acquire);
+        if (connection == nullptr || slot.generation.load(std::memory_order_acquire) != generation)
+            { return false; }
+        return connection->destroy();
+        }
+
     class WSlotObject
         {
     private:
         friend inline void internal::events::register_connection(WSlotObject *, ConnectionBase *);
         friend inline void internal::events::unregister_connection(WSlotObject *, ConnectionBase *);
 
-        std::unordered_set<std::shared_ptr<internal::events::ConnectionBase> > connections;
+        std::unordered_set<internal::events::ConnectionBase *,
+                           std::hash<internal::events::ConnectionBase *>,
+                           std::equal_to<internal::events::ConnectionBase *>,
+                           internal::pool::Allocator<internal::events::ConnectionBase *> > connections;
+        std::mutex connections_mutex;
+        std::atomic<WEventLoop *> loop;
 
     protected:
         WSlotObject()
+                : loop(nullptr)
             {}
 
-    public:
-
-    ConOps::ConOps(const ConOps &copy)
-            : mutexActions(copy.mutexActions->clone()),
-              threadActions(copy.threadActions->clone())
-        {}
-
-    ConOps &ConOps::operator=(const ConOps &copy)
-        {
-        release_resources();
-        mutexActions = copy.mutexActions->clone();
-        threadActions = copy.threadActions->clone();
-        return *this;
-        }
-
-    ConOps::ConOps()
-            : mutexActions(new internal::events::NoMutex()),
-              threadActions(new internal::events::NoThread())
-        {}
+        //method connections made to an object with a loop run on that loop's thread, the object
+        //should then also be destroyed on that thread
+        explicit WSlotObject(WEventLoop &loop)
+                : loop(&loop)
+            {}
 
-    ConOps &ConOps::blocking(bool value)
-        {
-        if (value)
-            { threadActions = new internal::events::NoThread(); }
-        else
-            { threadActions = new internal::events::Thread(); }
-        return *this;
-        }
+    public:
+        //only affects connections made after the call
+        void set_event_loop(WEventLoop *value)
+            { loop.store(value, std::memory_order_release); }
 
-    ConOps &ConOps::mutex(std::mutex &mutex)
-        {
-        delete mutexActions;
-        mutexActions = new typename internal::events::Mutex(mutex);
-        return *this;
-        }
+        WEventLoop *event_loop() const
+            { return loop.load(std::memory_order_acquire); }
 
-    void ConOps::release_resources()
-        {
-        if (mutexActions != nullptr)
-            { delete mutexActions; }
-        if (threadActions != nullptr)
-            { delete threadActions; }
-        }
+        //a connection another thread is disconnecting stays listed until it has unregistered, so this
+        //waits for that before the mutex goes away. the guard keeps listed connections from being freed
+        virtual ~WSlotObject()
+            {
+            internal::epoch::Guard guard;
+            std::vector<internal::events::ConnectionBase *> conn_copy;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex);
+                conn_copy.assign(connections.begin(), connections.end());
+            }
+            for (internal::events::ConnectionBase *connection : conn_copy)
+                { connection->destroy(); }
+            for (;;)
+                {
+                {
+                    std::lock_guard<std::mutex> lock(connections_mutex);
+                    if (connections.empty())
+                        { break; }
+                }
+                std::this_thread::yield();
+                }
+            }
+        };
 
     namespace internal
         {
         namespace events
             {
             inline void register_connection(WSlotObject *object, ConnectionBase *ptr)
-                { object->connections.insert(ptr); }
+                {
+                std::lock_guard<std::mutex> lock(object->connections_mutex);
+                object->connections.insert(ptr);
+                }
 
             inline void unregister_connection(WSlotObject *object, ConnectionBase *ptr)
-                { object->connections.erase(ptr); }
+                {
+                std::lock_guard<std::mutex> lock(object->connections_mutex);
+                object->connections.erase(ptr);
+                }
+
+            //synchronous slots get the emitted arguments by reference, by value arguments are passed as const
+            template<class T>
+            using ArgRef = typename std::conditional<std::is_reference<T>::value, T, const T &>::type;
+
+            //slots are stored taking ArgRef so by value arguments are not copied once per connected slot
+            template<class... Args>
+            using Slot = WFunction<void(ArgRef<Args>...)>;
+
+            //non blocking slots get their own copy of the arguments unless the type can't be copied
+            template<class T>
+            using PayloadType = typename std::conditional<
+                    std::is_copy_constructible<typename std::decay<T>::type>::value,
+                    typename std::decay<T>::type,
+                    T
+            >::type;
+
+            //one copy of the arguments shared by every non blocking connection of a single emit
+            template<class... Args>
+            class AsyncPayload : public pool::Pooled
+                {
+            private:
+                std::atomic<std::size_t> references;
+
+            public:
+                std::tuple<PayloadType<Args>...> args;
+
+                AsyncPayload(ArgRef<Args>... args)
+                        : references(1),
+                          args(args...)
+                    {}
+
+                void retain()
+                    { references.fetch_add(1, std::memory_order_relaxed); }
+
+                void release()
+                    {
+                    if (references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        { delete this; }
+                    }
+                };
+
+            template<class... Args>
+            class PostedCall;
 
             template<class... Args>
             class Connection : public ConnectionBase
                 {
             private:
                 WSignal<Args...> *signal;
+                Slot<Args...> slot;
 
             protected:
-                Connection(WSignal<Args...> *signal, ConOps &&options)
+                Connection(WSignal<Args...> *signal, ConOps &&options, Slot<Args...> &&slot)
                         : ConnectionBase(std::move(options)),
-                          signal(signal)
-                    { signal->register_connection((Connection<Args...> *) this); }
+                          signal(signal),
+                          slot(std::move(slot))
+                    {}
+
+                void unregister()
+                    { signal->unregister_connection((Connection<Args...> *) this); }
 
             public:
+                //plain synchronous connection, nothing to lock or hand off
+                void invoke(ArgRef<Args>... args)
+                    {
+#ifdef WEVENTS_INSTRUMENTATION
+                    instrument::SlotTimer timer(this->get_counters(), instrument::sample());
+#endif
+                    slot(args...);
+                    }
 
-                virtual void call_impl(std::tuple<Args...> &args) = 0;
+                //only called once the connection is fully constructed since emit may pick it up right away
+                void attach()
+                    { signal->register_connection((Connection<Args...> *) this); }
 
-                virtual ~Connection()
-                    { signal->unregister_connection((Connection<Args...> *) this); }
+                void call(ArgRef<Args>... args)
+                    {
+                    if (get_options().has_mutex())
+                        {
+#ifdef WEVENTS_INSTRUMENTATION
+                        bool sampled = instrument::sample();
+                        std::uint64_t start = sampled ? instrument::ticks() : 0;
+                        std::lock_guard<std::mutex> lock(*get_options().get_mutex());
+                        if (sampled)
+                            { this->get_counters()->record_mutex_wait(instrument::ticks() - start); }
+                        instrument::SlotTimer timer(this->get_counters(), sampled);
+#else
+                        std::lock_guard<std::mutex> lock(*get_options().get_mutex());
+#endif
+                        slot(args...);
+                        }
+                    else
+                        {
+#ifdef WEVENTS_INSTRUMENTATION
+                        instrument::SlotTimer timer(this->get_counters(), instrument::sample());
+#endif
+                        slot(args...);
+                        }
+                    }
 
-                void call(std::tuple<Args...>* args)
+                //the queued task holds a reference to both the connection and the payload
+                void post(AsyncPayload<Args...> *payload)
                     {
-                    //auto my_invokable = std::bind(call_impl, this, args);
-                    //my_invokable.operator()();
-                    get_options().get_thread_actions().execute(
-                            [this, =]()
-                                {
-                                get_options().get_mutex().execute(
-                                        [this]()
-                                            {
-                                            this->call_impl(*args); // <<<<<<< THIS LINE SEGFAULTS ON RARE OCCASIONS <<<<<<
-                                            delete args;
-                                            }
-                                );
-                                }, this
+#ifdef WEVENTS_INSTRUMENTATION
+                    this->get_counters()->record_post();
+#endif
+                    get_options().get_executor()->execute(
+                            PostedCall<Args...>(this, payload, trace::Flow::start(signal->slot_trace_name()))
                     );
                     }
                 };
 
+            //a call post() queued. the references are let go of when the task is destroyed, so an executor
+            //that drops a task without running it does not leak the connection or the payload
             template<class... Args>
-            class SignalCallbackConnection : public Connection<Args...>
+            class PostedCall
                 {
             private:
-                std::function<void(Args...)> callback;
+                Connection<Args...> *connection;
+                AsyncPayload<Args...> *payload;
+                trace::Flow flow;
 
             public:
-                void call_impl(std::tuple<Args...> &args)
-                    { std::experimental::apply(callback, args); }
+                PostedCall(Connection<Args...> *connection, AsyncPayload<Args...> *payload, const trace::Flow &flow)
+                        : connection(connection),
+                          payload(payload),
+                          flow(flow)
+                    {
+                    connection->retain();
+                    payload->retain();
+                    }
 
-                SignalCallbackConnection(
-                        WSignal<Args...> *signal,
-                        ConOps &&options,
-                        std::function<void(Args...)> callback
-                                        )
-                        : Connection<Args...>(signal, std::move(options)),
-                          callback(callback)
-                    {}
+                PostedCall(PostedCall &&other) noexcept
+                        : connection(other.connection),
+                          payload(other.payload),
+                          flow(other.flow)
+                    {
+                    other.connection = nullptr;
+                    other.payload = nullptr;
+                    }
+
+                PostedCall &operator=(PostedCall &&) = delete;
+
+                ~PostedCall()
+                    {
+                    if (payload != nullptr)
+                        { payload->release(); }
+                    if (connection != nullptr)
+                        { connection->release(); }
+                    }
+
+                void operator()()
+                    {
+                    trace::FlowScope scope(flow);
+                    if (connection->is_connected())
+                        {
+                        Connection<Args...> *target = connection;
+                        std::apply(
+                                [target](auto &... args)
+                                    { target->call(args...); }, payload->args
+                        );
+                        }
+                    }
                 };
 
-            template<class T, class... Args>
-            class MethodFunctor
+            template<class... Args>
+            class SignalCallbackConnection : public Connection<Args...>
                 {
-            private:
-                T *object;
-                void (T::*callback)(Args...);
-
             public:
-                MethodFunctor(T *object, void(T::*callback)(Args...))
-                        : object(object),
-                          callback(callback)
+                SignalCallbackConnection(
+                        WSignal<Args...> *signal,
+                        ConOps &&options,
+                        Slot<Args...> &&callback
+                                        )
+                        : Connection<Args...>(signal, std::move(options), std::move(callback))
                     {}
-
-                template<class... ArgTypes>
-                void operator()(ArgTypes &&... args) const
-                    { (object->*callback)(std::forward<ArgTypes>(args)...); }
                 };
 
             template<class T, class Enable, class... Args>
@@ -379,28 +689,35 @@ namespace wevents
                 {
             private:
                 T *object;
-                void (T::*callback)(Args...);
 
-            public:
-                void call_impl(std::tuple<Args...> &args)
+                //connections left at the default options follow the object's loop if it has one
+                static ConOps route(ConOps &&options, T *object)
                     {
-                    MethodFunctor<T, Args...> invokable(object, callback);
-                    std::experimental::apply(invokable, args);
+                    WEventLoop *loop = static_cast<WSlotObject *>(object)->event_loop();
+                    if (options.is_direct() && loop != nullptr)
+                        { options.affine(*loop); }
+                    return std::move(options);
                     }
 
+            public:
                 SignalObjectMethodConnection_impl(
                         WSignal<Args...> *signal,
                         ConOps &&options,
                         void (T::*callback)(Args...),
                         T *object
                                                  )
-                        : Connection<Args...>(signal, std::move(options)),
-                          callback(callback),
+                        : Connection<Args...>(
+                        signal, route(std::move(options), object), [object, callback](ArgRef<Args>... args)
+                            { (object->*callback)(args...); }
+                ),
                           object(object)
                     { register_connection(static_cast<WSlotObject *>(object), static_cast<ConnectionBase *>(this)); }
 
-                virtual ~SignalObjectMethodConnection_impl()
-                    { unregister_connection(static_cast<WSlotObject *>(object), static_cast<ConnectionBase *>(this)); }
+                void unregister()
+                    {
+                    unregister_connection(static_cast<WSlotObject *>(object), static_cast<ConnectionBase *>(this));
+                    Connection<Args...>::unregister();
+                    }
                 };
 
             template<class T, class... Args>
@@ -432,25 +749,23 @@ namespace wevents
                 {
             private:
                 T *object;
-                std::function<void(Args...)> callback;
 
             public:
-                void call_impl(std::tuple<Args...> &args)
-                    { std::experimental::apply(callback, args); }
-
                 SignalObjectLifetimeConnection_impl(
                         WSignal<Args...> *signal,
                         ConOps &&options,
-                        std::function<void(Args...)> callback,
+                        Slot<Args...> &&callback,
                         T *object
                                                    )
-                        : Connection<Args...>(signal, std::move(options)),
-                          callback(callback),
+                        : Connection<Args...>(signal, std::move(options), std::move(callback)),
                           object(object)
                     { register_connection(static_cast<WSlotObject *>(object), static_cast<ConnectionBase *>(this)); }
 
-                virtual ~SignalObjectLifetimeConnection_impl()
-                    { unregister_connection(static_cast<WSlotObject *>(object), static_cast<ConnectionBase *>(this)); }
+                void unregister()
+                    {
+                    unregister_connection(static_cast<WSlotObject *>(object), static_cast<ConnectionBase *>(this));
+                    Connection<Args...>::unregister();
+                    }
                 };
 
             template<class T, class... Args>
@@ -460,13 +775,13 @@ namespace wevents
                 SignalObjectLifetimeConnection(
                         WSignal<Args...> *signal,
                         ConOps &&options,
-                        std::function<void(Args...)> callback,
+                        Slot<Args...> &&callback,
                         T *object
                                               )
                         : SignalObjectLifetimeConnection_impl<T, void, Args...>(
                         signal,
                         std::move(options),
-                        callback,
+                        std::move(callback),
                         object
                 )
                     {}
@@ -487,9 +802,9 @@ namespace wevents
         }
 
     template<class... Args>
-    std::function<void()> connect(
+    WConnection connect(
             WSignal<Args...> &signal,
-            typename internal::events::Identity<std::function<void(Args...)> >::type callback,
+            typename internal::events::Identity<internal::events::Slot<Args...> >::type callback,
             ConOps options = {}
                                  )
         {
@@ -498,14 +813,14 @@ namespace wevents
                 std::move(
                         options
                 ),
-                callback
+                std::move(callback)
         );
-        return [&]()
-            { delete connection; };
+        connection->attach();
+        return connection->handle();
         }
 
     template<class T, class... Args>
-    std::function<void()> connect(
+    WConnection connect(
             WSignal<Args...> &signal,
             typename internal::events::Identity<void (T::*)(Args...)>::type callback,
             T *ptr,
@@ -519,14 +834,14 @@ namespace wevents
                 callback,
                 ptr
         );
-        return [&]()
-            { delete connection; };
+        connection->attach();
+        return connection->handle();
         }
 
     template<class T, class... Args>
-    std::function<void()> connect(
+    WConnection connect(
             WSignal<Args...> &signal,
-            std::function<void(Args...)> callback,
+            typename internal::events::Identity<internal::events::Slot<Args...> >::type callback,
             T *ptr,
             ConOps options = {}
                                  )
@@ -535,11 +850,11 @@ namespace wevents
                                                                                                                  Args...>(
                 &signal,
                 std::move(options),
-                callback,
+                std::move(callback),
                 ptr
         );
-        return [&]()
-            { delete connection; };
+        connection->attach();
+        return connection->handle();
         }
 
     namespace internal
@@ -567,6 +882,41 @@ namespace wevents
                     : std::true_type
                 {
                 };
+
+            //immutable once published, connect and disconnect build a new one and retire the old.
+            //the pointers are stored right behind the header so a list is a single pooled block
+            template<class... Args>
+            class ConnectionList
+                {
+            private:
+                std::size_t count;
+
+                ConnectionList(std::size_t count)
+                        : count(count)
+                    {}
+
+                static std::size_t bytes(std::size_t count)
+                    { return sizeof(ConnectionList) + count * sizeof(Connection<Args...> *); }
+
+            public:
+                static ConnectionList *create(std::size_t count)
+                    { return ::new(pool::allocate(bytes(count))) ConnectionList(count); }
+
+                static void destroy(void *ptr)
+                    {
+                    ConnectionList *list = static_cast<ConnectionList *>(ptr);
+                    pool::deallocate(list, bytes(list->count));
+                    }
+
+                std::size_t size() const
+                    { return count; }
+
+                Connection<Args...> **begin()
+                    { return reinterpret_cast<Connection<Args...> **>(this + 1); }
+
+                Connection<Args...> **end()
+                    { return begin() + count; }
+                };
             }
         }
 
@@ -577,39 +927,154 @@ namespace wevents
 
         friend class internal::events::Connection<Args...>;
 
-        std::unordered_set<internal::events::Connection<Args...> *> connections;
+        typedef internal::events::ConnectionList<Args...> list_type;
+
+        std::atomic<list_type *> connections;
+        std::atomic<std::size_t> count;
+        std::mutex writer_mutex;
+#ifdef WEVENTS_TRACING
+        std::atomic<const char *> emit_name;
+        std::atomic<const char *> slot_name;
+#endif
+#ifdef WEVENTS_INSTRUMENTATION
+        internal::instrument::SignalCounters counters;
+
+        static void collect_stats(const void *owner, std::vector<WConnectionStats> &out, double ns_per_tick)
+            {
+            const WSignal *signal = static_cast<const WSignal *>(owner);
+            internal::epoch::Guard guard;
+            list_type *list = signal->connections.load(std::memory_order_acquire);
+            if (list == nullptr)
+                { return; }
+            for (internal::events::Connection<Args...> *connection : *list)
+                {
+                if (connection->is_connected())
+                    { out.push_back(connection->get_counters()->snapshot(ns_per_tick)); }
+                }
+            }
+#endif
+
+        void publish(list_type *list)
+            {
+            list_type *old = connections.exchange(list, std::memory_order_acq_rel);
+            count.store(list == nullptr ? 0 : list->size(), std::memory_order_release);
+            if (old != nullptr)
+                { internal::epoch::retire(old, &list_type::destroy); }
+            }
 
         void register_connection(internal::events::Connection<Args...> *ptr)
-            { connections.insert(ptr); }
+            {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            list_type *current = connections.load(std::memory_order_relaxed);
+            std::size_t size = current == nullptr ? 0 : current->size();
+            list_type *list = list_type::create(size + 1);
+            if (current != nullptr)
+                { std::copy(current->begin(), current->end(), list->begin()); }
+            list->begin()[size] = ptr;
+            publish(list);
+            }
 
         void unregister_connection(internal::events::Connection<Args...> *ptr)
-            { connections.erase(ptr); }
-
-    public:
-        ~WSignal()
             {
-            const size_t ARRAY_SIZE = connections.size();
-            internal::events::ConnectionBase **conn_copy = new internal::events::ConnectionBase *[ARRAY_SIZE];
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            list_type *current = connections.load(std::memory_order_relaxed);
+            if (current == nullptr)
+                { return; }
+
+            internal::events::Connection<Args...> **found = std::find(current->begin(), current->end(), ptr);
+            if (found == current->end())
+                { return; }
 
+            list_type *list = nullptr;
+            if (current->size() > 1)
+                {
+                list = list_type::create(current->size() - 1);
+                std::copy(found + 1, current->end(), std::copy(current->begin(), found, list->begin()));
+                }
+            publish(list);
+            }
+
+        void dispatch(internal::events::ArgRef<Args>... args)
             {
-                size_t i = 0;
-                for (internal::events::ConnectionBase *connection : connections)
+#ifdef WEVENTS_INSTRUMENTATION
+            counters.record_emit();
+#endif
+            //nobody listening, which is common for property signals, so skip entering the guard
+            if (count.load(std::memory_order_acquire) == 0)
+                { return; }
+            internal::trace::Span emit_span(emit_trace_name());
+            internal::epoch::Guard guard;
+            list_type *list = connections.load(std::memory_order_acquire);
+            if (list == nullptr)
+                { return; }
+
+            //connections disconnected during this emit stay readable until the guard is left but are skipped
+            internal::events::AsyncPayload<Args...> *payload = nullptr;
+            for (internal::events::Connection<Args...> *connection : *list)
+                {
+                if (!connection->is_connected())
+                    { continue; }
+                internal::trace::Span slot_span(slot_trace_name());
+                const ConOps &options = connection->get_options();
+                if (options.is_direct())
+                    { connection->invoke(args...); }
+                else if (options.is_blocking())
+                    { connection->call(args...); }
+                else if (options.is_affine() && WEventLoop::current() == options.get_executor())
+                    { connection->call(args...); }
+                else
                     {
-                    conn_copy[i] = connection;
-                    i++;
+                    if (payload == nullptr)
+                        { payload = new internal::events::AsyncPayload<Args...>(args...); }
+                    connection->post(payload);
                     }
+                }
+            if (payload != nullptr)
+                { payload->release(); }
+            }
+
+    public:
+        WSignal()
+                : connections(nullptr),
+                  count(0)
+#ifdef WEVENTS_TRACING
+                , emit_name("emit"),
+                  slot_name("slot")
+#endif
+#ifdef WEVENTS_INSTRUMENTATION
+                , counters(this, &WSignal::collect_stats)
+#endif
+            {
+#ifdef WEVENTS_INSTRUMENTATION
+            internal::instrument::registry().add(&counters);
+#endif
             }
 
-            for (size_t i = 0; i < ARRAY_SIZE; i++)
+        ~WSignal()
+            {
+#ifdef WEVENTS_INSTRUMENTATION
+            internal::instrument::registry().remove(&counters);
+#endif
+            //same as ~WSlotObject, disconnects running on other threads finish unregistering first
+            internal::epoch::Guard guard;
+            std::vector<internal::events::Connection<Args...> *> conn_copy;
+            {
+                std::lock_guard<std::mutex> lock(writer_mutex);
+                list_type *current = connections.load(std::memory_order_relaxed);
+                if (current != nullptr)
+                    { conn_copy.assign(current->begin(), current->end()); }
+            }
+            for (internal::events::Connection<Args...> *connection : conn_copy)
+                { connection->destroy(); }
+            for (;;)
                 {
-                if (conn_copy[i]->get_options().is_blocking()
-                    && (conn_copy[i]->get_state() == internal::events::ConnectionBase::RUNNING))
-                    { conn_copy[i]->set_state(internal::events::ConnectionBase::DELETE_SELF); }
-                else
-                    { delete conn_copy[i]; }
+                {
+                    std::lock_guard<std::mutex> lock(writer_mutex);
+                    if (connections.load(std::memory_order_relaxed) == nullptr)
+                        { break; }
+                }
+                std::this_thread::yield();
                 }
-
-            delete[] conn_copy;
             }
 
         template<class... ArgTypes>
@@ -621,24 +1086,119 @@ namespace wevents
                     "one of your arguments in not the correct type"
             );
 
-            std::vector<internal::events::Connection<Args...> *> conn_copy;
-            for (internal::events::Connection<Args...> *connection : connections)
-                { conn_copy.push_back(connection); }
+            dispatch(std::forward<ArgTypes>(args)...);
+            }
 
-            //std::shared_ptr<std::tuple<Args...> > tup = std::make_shared<std::tuple<Args...> >(args...);
-            for (internal::events::Connection<Args...> *connection : conn_copy)
-                { connection->call(new std::tuple<Args...> >(args...)); }
+        //how many connections are attached right now, only a hint while others connect or disconnect
+        std::size_t connection_count() const
+            { return count.load(std::memory_order_acquire); }
+
+        bool has_connections() const
+            { return connection_count() != 0; }
+
+        //shows up in instrumentation_snapshot() and names the events of this signal in a trace,
+        //does nothing without WEVENTS_INSTRUMENTATION or WEVENTS_TRACING
+        void set_name(const std::string &name)
+            {
+#ifdef WEVENTS_INSTRUMENTATION
+            internal::instrument::registry().set_name(&counters, name);
+#endif
+#ifdef WEVENTS_TRACING
+            emit_name.store(internal::trace::tracer().intern(name), std::memory_order_relaxed);
+            slot_name.store(internal::trace::tracer().intern(name + "/slot"), std::memory_order_relaxed);
+#endif
+            (void) name;
+            }
+
+        //null when tracing is compiled out
+        const char *emit_trace_name() const
+            {
+#ifdef WEVENTS_TRACING
+            return emit_name.load(std::memory_order_relaxed);
+#else
+            return nullptr;
+#endif
+            }
+
+        const char *slot_trace_name() const
+            {
+#ifdef WEVENTS_TRACING
+            return slot_name.load(std::memory_order_relaxed);
+#else
+            return nullptr;
+#endif
             }
         };
 
     template<class... Args>
-    std::function<void()> connect(WSignal<Args...> &signal1, WSignal<Args...> &signal2, ConOps options = {})
+    WConnection connect(WSignal<Args...> &signal1, WSignal<Args...> &signal2, ConOps options = {})
         {
-        internal::events::Connection<Args...> *connection = new internal::events::SignalObjectMethodConnection<WSignal<
-                Args...>, Args...>(&signal1, std::move(options), &WSignal<Args...>::emit, &signal2);
-        return [&]()
-            { delete connection; };
+        WSignal<Args...> *target = &signal2;
+        internal::events::Connection<Args...> *connection = new internal::events::SignalObjectLifetimeConnection<
+                WSignal<Args...>, Args...>(
+                &signal1,
+                std::move(options),
+                [target](internal::events::ArgRef<Args>... args)
+                    { target->emit(args...); },
+                target
+        );
+        connection->attach();
+        return connection->handle();
         }
+
+    //a WSignal only allocated once something connects to it, for signals most owners never have
+    //connected. emitting it before then only loads a pointer
+    template<class... Args>
+    class WLazySignal
+        {
+    private:
+        std::atomic<WSignal<Args...> *> signal;
+
+    public:
+        WLazySignal()
+                : signal(nullptr)
+            {}
+
+        WLazySignal(const WLazySignal &) = delete;
+        WLazySignal &operator=(const WLazySignal &) = delete;
+
+        ~WLazySignal()
+            { delete signal.load(std::memory_order_acquire); }
+
+        //allocates the signal, connecting from several threads at once ends up with the same one
+        WSignal<Args...> &get()
+            {
+            WSignal<Args...> *current = signal.load(std::memory_order_acquire);
+            if (current == nullptr)
+                {
+                WSignal<Args...> *created = new WSignal<Args...>();
+                if (signal.compare_exchange_strong(current, created, std::memory_order_acq_rel, std::memory_order_acquire))
+                    { current = created; }
+                else
+                    { delete created; }
+                }
+            return *current;
+            }
+
+        bool has_connections() const
+            {
+            WSignal<Args...> *current = signal.load(std::memory_order_acquire);
+            return current != nullptr && current->has_connections();
+            }
+
+        template<class... ArgTypes>
+        void emit(ArgTypes &&... args)
+            {
+            WSignal<Args...> *current = signal.load(std::memory_order_acquire);
+            if (current != nullptr)
+                { current->emit(std::forward<ArgTypes>(args)...); }
+            }
+        };
+
+    //every connect() above works on a WLazySignal too
+    template<class... Args, class... Rest>
+    WConnection connect(WLazySignal<Args...> &signal, Rest &&... rest)
+        { return connect(signal.get(), std::forward<Rest>(rest)...); }
     }
 
 #endif //WGUI_W_EVENT_H
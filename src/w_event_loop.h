@@ -0,0 +1,233 @@
+#ifndef WEVENTS_W_EVENT_LOOP_H
+#define WEVENTS_W_EVENT_LOOP_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstddef>
+
+#include "w_executor.h"
+#include "w_function.h"
+#include "w_pool.h"
+
+namespace wevents
+    {
+    struct WEventLoopStats
+        {
+        //tasks waiting right now, the most that were ever waiting at once and what has been run so far
+        std::size_t pending;
+        std::size_t peak_pending;
+        std::size_t processed;
+        std::size_t batches;
+
+        double average_batch() const
+            { return batches == 0 ? 0.0 : double(processed) / double(batches); }
+        };
+
+    //an executor that is drained by whichever thread calls run() (or process_events()), so everything
+    //posted to it runs on that one thread in the order it was posted by each producer. posting never
+    //takes a lock, producers only touch the mutex to wake the loop up when it is sleeping
+    class WEventLoop : public WExecutor
+        {
+    private:
+        //the queue always holds one spent node at the tail, popping moves the task out of the node
+        //after it and frees the spent one
+        struct Node : public internal::pool::Pooled
+            {
+            std::atomic<Node *> next;
+            WFunction<void()> task;
+
+            Node()
+                    : next(nullptr)
+                {}
+
+            explicit Node(WFunction<void()> &&task)
+                    : next(nullptr),
+                      task(std::move(task))
+                {}
+            };
+
+        std::atomic<Node *> head;
+        Node *tail;
+
+        std::atomic<std::size_t> pending;
+        std::atomic<std::size_t> peak_pending;
+        std::atomic<std::size_t> processed;
+        std::atomic<std::size_t> batches;
+
+        std::atomic<bool> sleeping;
+        std::atomic<bool> quitting;
+        std::atomic<std::thread::id> owner;
+        std::mutex mutex;
+        std::condition_variable wake;
+
+        static WEventLoop *&current_slot()
+            {
+            static thread_local WEventLoop *loop = nullptr;
+            return loop;
+            }
+
+        //only ever called by the thread draining the loop
+        bool pop(WFunction<void()> &task)
+            {
+            Node *next = tail->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+                { return false; }
+            task = std::move(next->task);
+            delete tail;
+            tail = next;
+            return true;
+            }
+
+        void note_pending(std::size_t depth)
+            {
+            std::size_t peak = peak_pending.load(std::memory_order_relaxed);
+            while (depth > peak && !peak_pending.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+                {}
+            }
+
+        void wait_for_work()
+            {
+            sleeping.store(true, std::memory_order_seq_cst);
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]()
+                { return pending.load(std::memory_order_seq_cst) > 0 || quitting.load(std::memory_order_relaxed); });
+            sleeping.store(false, std::memory_order_relaxed);
+            }
+
+        class CurrentScope
+            {
+        private:
+            WEventLoop *previous;
+
+        public:
+            explicit CurrentScope(WEventLoop *loop)
+                    : previous(current_slot())
+                { current_slot() = loop; }
+
+            ~CurrentScope()
+                { current_slot() = previous; }
+            };
+
+    public:
+        static const std::size_t DEFAULT_BATCH = 64;
+
+        WEventLoop()
+                : head(new Node()),
+                  pending(0),
+                  peak_pending(0),
+                  processed(0),
+                  batches(0),
+                  sleeping(false),
+                  quitting(false),
+                  owner(std::thread::id())
+            { tail = head.load(std::memory_order_relaxed); }
+
+        WEventLoop(const WEventLoop &) = delete;
+        WEventLoop &operator=(const WEventLoop &) = delete;
+
+        //tasks that never got run are destroyed without being called, they let go of what they hold
+        ~WEventLoop()
+            {
+            Node *node = tail;
+            while (node != nullptr)
+                {
+                Node *next = node->next.load(std::memory_order_acquire);
+                delete node;
+                node = next;
+                }
+            }
+
+        void execute(WFunction<void()> task) override
+            {
+            Node *node = new Node(std::move(task));
+            Node *previous = head.exchange(node, std::memory_order_acq_rel);
+            previous->next.store(node, std::memory_order_release);
+
+            note_pending(pending.fetch_add(1, std::memory_order_seq_cst) + 1);
+            if (sleeping.load(std::memory_order_seq_cst))
+                {
+                std::lock_guard<std::mutex> lock(mutex);
+                wake.notify_one();
+                }
+            }
+
+        //runs at most max_batch of the tasks that are already queued without waiting for more and
+        //returns how many were run. meant for threads that already have a loop of their own
+        std::size_t process_events(std::size_t max_batch = DEFAULT_BATCH)
+            {
+            CurrentScope scope(this);
+            std::size_t count = 0;
+            WFunction<void()> task;
+            while (count < max_batch && pop(task))
+                {
+                pending.fetch_sub(1, std::memory_order_relaxed);
+                task();
+                task = nullptr;
+                count++;
+                }
+            if (count > 0)
+                {
+                processed.fetch_add(count, std::memory_order_relaxed);
+                batches.fetch_add(1, std::memory_order_relaxed);
+                }
+            return count;
+            }
+
+        //drains the queue on the calling thread until quit() is called, sleeping while it is empty
+        void run(std::size_t max_batch = DEFAULT_BATCH)
+            {
+            CurrentScope scope(this);
+            owner.store(std::this_thread::get_id(), std::memory_order_release);
+            while (!quitting.load(std::memory_order_acquire))
+                {
+                if (process_events(max_batch) > 0)
+                    { continue; }
+                if (pending.load(std::memory_order_acquire) > 0)
+                    {
+                    //a producer has claimed its spot in the queue but not linked it in yet
+                    std::this_thread::yield();
+                    continue;
+                    }
+                wait_for_work();
+                }
+            quitting.store(false, std::memory_order_relaxed);
+            owner.store(std::thread::id(), std::memory_order_release);
+            }
+
+        //makes run() return once the batch it is working on is done, whatever is left stays queued
+        void quit()
+            {
+            std::lock_guard<std::mutex> lock(mutex);
+            quitting.store(true, std::memory_order_release);
+            wake.notify_all();
+            }
+
+        //true on the thread that is inside run() or process_events() of this loop
+        bool is_current() const
+            { return current_slot() == this; }
+
+        //the thread inside run(), a default id while nobody is running the loop
+        std::thread::id thread_id() const
+            { return owner.load(std::memory_order_acquire); }
+
+        std::size_t queue_depth() const
+            { return pending.load(std::memory_order_relaxed); }
+
+        WEventLoopStats stats() const
+            {
+            WEventLoopStats stats = {pending.load(std::memory_order_relaxed),
+                                     peak_pending.load(std::memory_order_relaxed),
+                                     processed.load(std::memory_order_relaxed),
+                                     batches.load(std::memory_order_relaxed)};
+            return stats;
+            }
+
+        //the loop whose tasks the calling thread is running, if any
+        static WEventLoop *current()
+            { return current_slot(); }
+        };
+    }
+
+#endif //WEVENTS_W_EVENT_LOOP_H
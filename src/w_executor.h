@@ -0,0 +1,134 @@
+#ifndef WEVENTS_W_EXECUTOR_H
+#define WEVENTS_W_EXECUTOR_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+#include "w_function.h"
+
+namespace wevents
+    {
+    //something that non blocking connections can hand their invocations off to
+    class WExecutor
+        {
+    public:
+        virtual ~WExecutor()
+            {}
+
+        virtual void execute(WFunction<void()> task) = 0;
+        };
+
+    //fixed number of worker threads pulling tasks off a bounded queue.
+    //when the queue is full execute() blocks until a worker frees up a spot
+    class WThreadPool : public WExecutor
+        {
+    private:
+        std::vector<std::thread> workers;
+        std::vector<WFunction<void()> > queue;
+        std::size_t head;
+        std::size_t count;
+        bool stopping;
+
+        std::mutex mutex;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+
+        static WThreadPool *&current()
+            {
+            static thread_local WThreadPool *pool = nullptr;
+            return pool;
+            }
+
+        void worker_loop()
+            {
+            current() = this;
+            while (true)
+                {
+                WFunction<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    not_empty.wait(lock, [this]()
+                        { return stopping || count > 0; });
+                    if (count == 0)
+                        { return; }
+                    task = std::move(queue[head]);
+                    head = (head + 1) % queue.size();
+                    count--;
+                }
+                not_full.notify_one();
+                task();
+                }
+            }
+
+    public:
+        static std::size_t default_thread_count()
+            {
+            std::size_t threads = std::thread::hardware_concurrency();
+            return threads == 0 ? 2 : threads;
+            }
+
+        explicit WThreadPool(std::size_t threads = default_thread_count(), std::size_t queue_capacity = 1024)
+                : queue(queue_capacity == 0 ? 1 : queue_capacity),
+                  head(0),
+                  count(0),
+                  stopping(false)
+            {
+            if (threads == 0)
+                { threads = 1; }
+            workers.reserve(threads);
+            for (std::size_t i = 0; i < threads; i++)
+                { workers.emplace_back(&WThreadPool::worker_loop, this); }
+            }
+
+        WThreadPool(const WThreadPool &) = delete;
+        WThreadPool &operator=(const WThreadPool &) = delete;
+
+        //tasks that are already queued still get run before the workers exit
+        ~WThreadPool()
+            {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            not_empty.notify_all();
+            for (std::thread &worker : workers)
+                { worker.join(); }
+            }
+
+        void execute(WFunction<void()> task) override
+            {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (count == queue.size() && current() == this)
+                {
+                //a worker waiting on its own full queue could deadlock the pool so just run it here
+                lock.unlock();
+                task();
+                return;
+                }
+            not_full.wait(lock, [this]()
+                { return count < queue.size(); });
+            queue[(head + count) % queue.size()] = std::move(task);
+            count++;
+            lock.unlock();
+            not_empty.notify_one();
+            }
+
+        std::size_t thread_count() const
+            { return workers.size(); }
+
+        std::size_t queue_capacity() const
+            { return queue.size(); }
+
+        //pool used by ConOps().blocking(false) when no executor is given
+        static WThreadPool &shared()
+            {
+            static WThreadPool pool;
+            return pool;
+            }
+        };
+    }
+
+#endif //WEVENTS_W_EXECUTOR_H
@@ -0,0 +1,154 @@
+#ifndef WEVENTS_W_FUNCTION_H
+#define WEVENTS_W_FUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace wevents
+    {
+    template<class Signature, std::size_t Capacity = 6 * sizeof(void *)>
+    class WFunction;
+
+    //move only replacement for std::function. callables that fit into Capacity bytes are stored
+    //inside the object itself so wrapping a lambda never allocates, bigger ones go on the heap.
+    //a call is a single indirect call into code that has the callable's body inlined
+    template<class R, class... Args, std::size_t Capacity>
+    class WFunction<R(Args...), Capacity>
+        {
+    private:
+        enum Operation
+            {
+            MOVE,
+            DESTROY,
+            };
+
+        typedef R (*invoker_type)(void *, Args &&...);
+        typedef void (*manager_type)(Operation, void *, void *);
+
+        typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type storage;
+        invoker_type invoker;
+        manager_type manager;
+
+        template<class F>
+        struct stored_inline
+                : std::integral_constant<bool,
+                                         sizeof(F) <= Capacity
+                                         && alignof(F) <= alignof(std::max_align_t)
+                                         && std::is_nothrow_move_constructible<F>::value>
+            {
+            };
+
+        template<class F>
+        static R invoke_inline(void *storage, Args &&... args)
+            { return (*static_cast<F *>(storage))(std::forward<Args>(args)...); }
+
+        template<class F>
+        static void manage_inline(Operation operation, void *dst, void *src)
+            {
+            F *source = static_cast<F *>(src);
+            if (operation == MOVE)
+                { ::new(dst) F(std::move(*source)); }
+            source->~F();
+            }
+
+        template<class F>
+        static R invoke_heap(void *storage, Args &&... args)
+            { return (**static_cast<F **>(storage))(std::forward<Args>(args)...); }
+
+        template<class F>
+        static void manage_heap(Operation operation, void *dst, void *src)
+            {
+            F **source = static_cast<F **>(src);
+            if (operation == MOVE)
+                { ::new(dst) F *(*source); }
+            else
+                { delete *source; }
+            }
+
+        template<class F>
+        void store(F &&function, std::true_type)
+            {
+            typedef typename std::decay<F>::type functor;
+            ::new(static_cast<void *>(&storage)) functor(std::forward<F>(function));
+            invoker = &invoke_inline<functor>;
+            manager = &manage_inline<functor>;
+            }
+
+        template<class F>
+        void store(F &&function, std::false_type)
+            {
+            typedef typename std::decay<F>::type functor;
+            ::new(static_cast<void *>(&storage)) functor *(new functor(std::forward<F>(function)));
+            invoker = &invoke_heap<functor>;
+            manager = &manage_heap<functor>;
+            }
+
+        void move_from(WFunction &other)
+            {
+            invoker = other.invoker;
+            manager = other.manager;
+            if (manager != nullptr)
+                { manager(MOVE, &storage, &other.storage); }
+            other.invoker = nullptr;
+            other.manager = nullptr;
+            }
+
+        void reset()
+            {
+            if (manager != nullptr)
+                { manager(DESTROY, nullptr, &storage); }
+            invoker = nullptr;
+            manager = nullptr;
+            }
+
+    public:
+        WFunction()
+                : invoker(nullptr),
+                  manager(nullptr)
+            {}
+
+        WFunction(std::nullptr_t)
+                : WFunction()
+            {}
+
+        template<class F,
+                 class = typename std::enable_if<
+                         !std::is_same<typename std::decay<F>::type, WFunction>::value
+                         && std::is_invocable_r<R, typename std::decay<F>::type &, Args...>::value>::type>
+        WFunction(F &&function)
+                : WFunction()
+            {
+            typedef typename std::decay<F>::type functor;
+            store(std::forward<F>(function), stored_inline<functor>());
+            }
+
+        WFunction(WFunction &&other) noexcept
+            { move_from(other); }
+
+        WFunction &operator=(WFunction &&other) noexcept
+            {
+            if (this != &other)
+                {
+                reset();
+                move_from(other);
+                }
+            return *this;
+            }
+
+        WFunction(const WFunction &) = delete;
+        WFunction &operator=(const WFunction &) = delete;
+
+        ~WFunction()
+            { reset(); }
+
+        explicit operator bool() const
+            { return invoker != nullptr; }
+
+        R operator()(Args... args)
+            { return invoker(&storage, std::forward<Args>(args)...); }
+        };
+    }
+
+#endif //WEVENTS_W_FUNCTION_H
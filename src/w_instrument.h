@@ -0,0 +1,403 @@
+#ifndef WEVENTS_W_INSTRUMENT_H
+#define WEVENTS_W_INSTRUMENT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(WEVENTS_INSTRUMENTATION) || defined(WEVENTS_TRACING)
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+#include "w_pool.h"
+
+namespace wevents
+    {
+    //power of two latency buckets, bucket i holds durations below 2^i nanoseconds (the last one
+    //holds everything longer)
+    struct WHistogramSnapshot
+        {
+        std::vector<std::uint64_t> buckets;
+
+        std::uint64_t count() const
+            {
+            std::uint64_t total = 0;
+            for (std::uint64_t bucket : buckets)
+                { total += bucket; }
+            return total;
+            }
+
+        //upper bound of the bucket the given fraction (0 to 1) of samples falls into
+        std::uint64_t percentile_ns(double fraction) const
+            {
+            std::uint64_t total = count();
+            if (total == 0)
+                { return 0; }
+            std::uint64_t rank = std::uint64_t(fraction * double(total - 1)) + 1;
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < buckets.size(); i++)
+                {
+                seen += buckets[i];
+                if (seen >= rank)
+                    { return std::uint64_t(1) << i; }
+                }
+            return std::uint64_t(1) << (buckets.size() - 1);
+            }
+
+        void merge(const WHistogramSnapshot &other)
+            {
+            if (buckets.size() < other.buckets.size())
+                { buckets.resize(other.buckets.size(), 0); }
+            for (std::size_t i = 0; i < other.buckets.size(); i++)
+                { buckets[i] += other.buckets[i]; }
+            }
+        };
+
+    struct WConnectionStats
+        {
+        std::uint64_t invocations;
+        std::uint64_t posts;
+        std::uint64_t slot_ns;
+        std::uint64_t mutex_wait_ns;
+        WHistogramSnapshot slot_time;
+        WHistogramSnapshot mutex_wait;
+        };
+
+    //totals are over the connections the signal has right now
+    struct WSignalStats
+        {
+        std::string name;
+        const void *signal;
+        std::uint64_t emits;
+        std::uint64_t invocations;
+        std::uint64_t posts;
+        std::uint64_t slot_ns;
+        std::uint64_t mutex_wait_ns;
+        WHistogramSnapshot slot_time;
+        WHistogramSnapshot mutex_wait;
+        std::vector<WConnectionStats> connections;
+        };
+
+    namespace internal
+        {
+        //counters behind WEVENTS_INSTRUMENTATION. without it none of this is compiled into signals
+        //or connections and the snapshot is always empty
+        namespace instrument
+            {
+#if defined(WEVENTS_INSTRUMENTATION) || defined(WEVENTS_TRACING)
+            //tsc ticks where available, they cost a few cycles to read. they are turned into
+            //nanoseconds when a snapshot is taken
+            inline std::uint64_t ticks()
+                {
+#if defined(__x86_64__) || defined(__i386__)
+                return __rdtsc();
+#else
+                return std::uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+                }
+
+            class Clock
+                {
+            private:
+                std::uint64_t start_ticks;
+                std::chrono::steady_clock::time_point start_time;
+
+            public:
+                Clock()
+                        : start_ticks(ticks()),
+                          start_time(std::chrono::steady_clock::now())
+                    {}
+
+                //nanoseconds since the clock was created
+                double to_ns(std::uint64_t value, double ns_per_tick) const
+                    { return double(std::int64_t(value - start_ticks)) * ns_per_tick; }
+
+                //measured over everything since the first counter was touched
+                double ns_per_tick() const
+                    {
+#if defined(__x86_64__) || defined(__i386__)
+                    std::uint64_t elapsed_ticks = ticks() - start_ticks;
+                    double elapsed_ns = std::chrono::duration<double, std::nano>(
+                            std::chrono::steady_clock::now() - start_time
+                    ).count();
+                    return elapsed_ticks == 0 ? 1.0 : elapsed_ns / double(elapsed_ticks);
+#else
+                    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::duration(1)).count();
+#endif
+                    }
+                };
+
+            inline Clock &clock()
+                {
+                static Clock *instance = new Clock();
+                return *instance;
+                }
+#endif
+
+#ifdef WEVENTS_INSTRUMENTATION
+            //reading the clock costs more than the counters so only one call in SAMPLE_EVERY per
+            //thread is timed, time totals are scaled up from those samples
+#ifndef WEVENTS_INSTRUMENTATION_SAMPLE_EVERY
+#define WEVENTS_INSTRUMENTATION_SAMPLE_EVERY 16
+#endif
+            const std::uint32_t SAMPLE_EVERY = WEVENTS_INSTRUMENTATION_SAMPLE_EVERY;
+
+            inline bool sample()
+                {
+                static thread_local std::uint32_t calls = 0;
+                return ++calls % SAMPLE_EVERY == 0;
+                }
+
+            //in ticks, kept small enough for the counters of a connection to fit in one pool block.
+            //bucket i holds durations below 2^(i + SHIFT) ticks
+            class Histogram
+                {
+            public:
+                static const std::size_t BUCKETS = 24;
+                static const std::size_t SHIFT = 4;
+
+            private:
+                std::atomic<std::uint32_t> counts[BUCKETS];
+
+            public:
+                Histogram()
+                    {
+                    for (std::size_t i = 0; i < BUCKETS; i++)
+                        { counts[i].store(0, std::memory_order_relaxed); }
+                    }
+
+                void record(std::uint64_t ticks)
+                    {
+                    std::size_t bits = ticks == 0 ? 0 : std::size_t(64 - __builtin_clzll(ticks));
+                    std::size_t index = bits > SHIFT ? bits - SHIFT : 0;
+                    if (index >= BUCKETS)
+                        { index = BUCKETS - 1; }
+                    counts[index].fetch_add(1, std::memory_order_relaxed);
+                    }
+
+                //rebuckets into nanoseconds
+                void snapshot(WHistogramSnapshot &out, double ns_per_tick) const
+                    {
+                    if (out.buckets.size() < 64)
+                        { out.buckets.resize(64, 0); }
+                    for (std::size_t i = 0; i < BUCKETS; i++)
+                        {
+                        std::uint64_t count = counts[i].load(std::memory_order_relaxed);
+                        if (count == 0)
+                            { continue; }
+                        double bound = double(std::uint64_t(1) << (i + SHIFT)) * ns_per_tick;
+                        std::size_t index = 0;
+                        while (index < 63 && double(std::uint64_t(1) << index) < bound)
+                            { index++; }
+                        out.buckets[index] += count;
+                        }
+                    }
+                };
+
+            struct ConnectionCounters : public pool::Pooled
+                {
+                std::atomic<std::uint64_t> invocations;
+                std::atomic<std::uint64_t> posts;
+                std::atomic<std::uint64_t> samples;
+                std::atomic<std::uint64_t> slot_ticks;
+                std::atomic<std::uint64_t> mutex_wait_ticks;
+                Histogram slot_time;
+                Histogram mutex_wait;
+
+                ConnectionCounters()
+                        : invocations(0),
+                          posts(0),
+                          samples(0),
+                          slot_ticks(0),
+                          mutex_wait_ticks(0)
+                    {}
+
+                void record_invocation()
+                    { invocations.fetch_add(1, std::memory_order_relaxed); }
+
+                void record_slot(std::uint64_t ticks)
+                    {
+                    samples.fetch_add(1, std::memory_order_relaxed);
+                    slot_ticks.fetch_add(ticks, std::memory_order_relaxed);
+                    slot_time.record(ticks);
+                    }
+
+                void record_mutex_wait(std::uint64_t ticks)
+                    {
+                    mutex_wait_ticks.fetch_add(ticks, std::memory_order_relaxed);
+                    mutex_wait.record(ticks);
+                    }
+
+                void record_post()
+                    { posts.fetch_add(1, std::memory_order_relaxed); }
+
+                WConnectionStats snapshot(double ns_per_tick) const
+                    {
+                    WConnectionStats stats;
+                    stats.invocations = invocations.load(std::memory_order_relaxed);
+                    stats.posts = posts.load(std::memory_order_relaxed);
+                    std::uint64_t sampled = samples.load(std::memory_order_relaxed);
+                    double scale = sampled == 0 ? 0.0 : ns_per_tick * double(stats.invocations) / double(sampled);
+                    stats.slot_ns = std::uint64_t(double(slot_ticks.load(std::memory_order_relaxed)) * scale);
+                    stats.mutex_wait_ns = std::uint64_t(double(mutex_wait_ticks.load(std::memory_order_relaxed)) * scale);
+                    slot_time.snapshot(stats.slot_time, ns_per_tick);
+                    mutex_wait.snapshot(stats.mutex_wait, ns_per_tick);
+                    return stats;
+                    }
+                };
+
+            //counts the slot call it is wrapped around and times it if it was sampled
+            class SlotTimer
+                {
+            private:
+                ConnectionCounters *counters;
+                std::uint64_t start;
+
+            public:
+                SlotTimer(ConnectionCounters *counters, bool sampled)
+                        : counters(counters),
+                          start(sampled ? ticks() : 0)
+                    { counters->record_invocation(); }
+
+                ~SlotTimer()
+                    {
+                    if (start != 0)
+                        { counters->record_slot(ticks() - start); }
+                    }
+                };
+
+            class SignalCounters
+                {
+            private:
+                friend class Registry;
+
+                SignalCounters *previous;
+                SignalCounters *next;
+                std::string name;
+
+            public:
+                typedef void (*collect_type)(const void *owner, std::vector<WConnectionStats> &out, double ns_per_tick);
+
+                const void *owner;
+                collect_type collect;
+                std::atomic<std::uint64_t> emits;
+
+                SignalCounters(const void *owner, collect_type collect)
+                        : previous(nullptr),
+                          next(nullptr),
+                          owner(owner),
+                          collect(collect),
+                          emits(0)
+                    {}
+
+                void record_emit()
+                    { emits.fetch_add(1, std::memory_order_relaxed); }
+                };
+
+            //every live signal, a snapshot holds the lock so none of them can go away while it is read
+            class Registry
+                {
+            private:
+                std::mutex mutex;
+                SignalCounters *head;
+
+            public:
+                Registry()
+                        : head(nullptr)
+                    { clock(); }
+
+                void add(SignalCounters *counters)
+                    {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    counters->next = head;
+                    if (head != nullptr)
+                        { head->previous = counters; }
+                    head = counters;
+                    }
+
+                void remove(SignalCounters *counters)
+                    {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (counters->previous != nullptr)
+                        { counters->previous->next = counters->next; }
+                    else
+                        { head = counters->next; }
+                    if (counters->next != nullptr)
+                        { counters->next->previous = counters->previous; }
+                    }
+
+                void set_name(SignalCounters *counters, const std::string &name)
+                    {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    counters->name = name;
+                    }
+
+                std::vector<WSignalStats> snapshot()
+                    {
+                    double ns_per_tick = clock().ns_per_tick();
+                    std::vector<WSignalStats> result;
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (SignalCounters *counters = head; counters != nullptr; counters = counters->next)
+                        {
+                        WSignalStats stats;
+                        stats.name = counters->name;
+                        stats.signal = counters->owner;
+                        stats.emits = counters->emits.load(std::memory_order_relaxed);
+                        stats.invocations = 0;
+                        stats.posts = 0;
+                        stats.slot_ns = 0;
+                        stats.mutex_wait_ns = 0;
+                        counters->collect(counters->owner, stats.connections, ns_per_tick);
+                        for (const WConnectionStats &connection : stats.connections)
+                            {
+                            stats.invocations += connection.invocations;
+                            stats.posts += connection.posts;
+                            stats.slot_ns += connection.slot_ns;
+                            stats.mutex_wait_ns += connection.mutex_wait_ns;
+                            stats.slot_time.merge(connection.slot_time);
+                            stats.mutex_wait.merge(connection.mutex_wait);
+                            }
+                        result.push_back(std::move(stats));
+                        }
+                    return result;
+                    }
+                };
+
+            //never destroyed, static signals unregister during exit
+            inline Registry &registry()
+                {
+                static Registry *instance = new Registry();
+                return *instance;
+                }
+#endif
+            }
+        }
+
+    //every signal alive right now with the counters of its connections. always empty unless the
+    //library is compiled with WEVENTS_INSTRUMENTATION
+    inline std::vector<WSignalStats> instrumentation_snapshot()
+        {
+#ifdef WEVENTS_INSTRUMENTATION
+        return internal::instrument::registry().snapshot();
+#else
+        return std::vector<WSignalStats>();
+#endif
+        }
+
+    inline constexpr bool instrumentation_enabled()
+        {
+#ifdef WEVENTS_INSTRUMENTATION
+        return true;
+#else
+        return false;
+#endif
+        }
+    }
+
+#endif //WEVENTS_W_INSTRUMENT_H
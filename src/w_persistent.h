@@ -0,0 +1,563 @@
+#ifndef WEVENTS_W_PERSISTENT_H
+#define WEVENTS_W_PERSISTENT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace wevents
+    {
+    namespace internal
+        {
+        //persistent containers share their nodes between copies. copying one only copies its root
+        //pointer, a write copies the nodes on its path that are shared and changes the rest in place
+        namespace persistent
+            {
+            //the count is atomic so copies can be handed to other threads
+            struct Counted
+                {
+                mutable std::atomic<std::size_t> count;
+
+                Counted()
+                        : count(0)
+                    {}
+
+                //a copy is a new node nobody refers to yet
+                Counted(const Counted &)
+                        : count(0)
+                    {}
+
+                Counted &operator=(const Counted &) = delete;
+                };
+
+            template<class Node>
+            class Ref
+                {
+            private:
+                Node *node;
+
+            public:
+                Ref()
+                        : node(nullptr)
+                    {}
+
+                explicit Ref(Node *node)
+                        : node(node)
+                    {
+                    if (node != nullptr)
+                        { node->count.fetch_add(1, std::memory_order_relaxed); }
+                    }
+
+                Ref(const Ref &other)
+                        : Ref(other.node)
+                    {}
+
+                Ref(Ref &&other) noexcept
+                        : node(other.node)
+                    { other.node = nullptr; }
+
+                ~Ref()
+                    {
+                    if (node != nullptr && node->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        { delete node; }
+                    }
+
+                Ref &operator=(Ref other) noexcept
+                    {
+                    std::swap(node, other.node);
+                    return *this;
+                    }
+
+                Node *get() const
+                    { return node; }
+
+                Node *operator->() const
+                    { return node; }
+
+                explicit operator bool() const
+                    { return node != nullptr; }
+
+                //nothing else refers to the node, it can be changed in place
+                bool unique() const
+                    { return node->count.load(std::memory_order_acquire) == 1; }
+
+                //the node after copying it if it is shared
+                Node *own()
+                    {
+                    if (!unique())
+                        { *this = Ref(new Node(*node)); }
+                    return node;
+                    }
+                };
+
+            inline unsigned popcount(std::uint32_t bits)
+                { return unsigned(__builtin_popcount(bits)); }
+
+            const unsigned BITS = 5;
+            const std::size_t WIDTH = std::size_t(1) << BITS;
+            const std::size_t MASK = WIDTH - 1;
+            }
+        }
+
+    //a persistent hash array mapped trie. entries sit in 32 way nodes indexed by 5 bits of their hash
+    //at a time, keys whose whole hash is equal end up in one list at the bottom. copies share all their
+    //nodes so copying is O(1) and a write copies the O(log n) nodes on its path that are still shared
+    template<class K, class V, class Hash = std::hash<K>, class Equal = std::equal_to<K> >
+    class WPersistentMap
+        {
+    private:
+        //entries holds the keys found at this level, children the subtrees, each ordered by the bit
+        //they take in datamap and nodemap. past the last level everything is in entries unordered
+        struct Node : internal::persistent::Counted
+            {
+            std::uint32_t datamap = 0;
+            std::uint32_t nodemap = 0;
+            std::vector<std::pair<K, V> > entries;
+            std::vector<internal::persistent::Ref<Node> > children;
+            };
+
+        typedef internal::persistent::Ref<Node> Ref;
+
+        static const unsigned LEAF_SHIFT = sizeof(std::size_t) * 8;
+
+        Ref root;
+        std::size_t count;
+
+        static std::size_t hash(const K &key)
+            { return Hash()(key); }
+
+        static std::uint32_t bit(std::size_t hash, unsigned shift)
+            { return std::uint32_t(1) << ((hash >> shift) & internal::persistent::MASK); }
+
+        static unsigned index(std::uint32_t map, std::uint32_t bit)
+            { return internal::persistent::popcount(map & (bit - 1)); }
+
+        //puts an entry into a node that has none at its position yet
+        static void place(Node *node, std::size_t hash, unsigned shift, std::pair<K, V> &&entry)
+            {
+            if (shift >= LEAF_SHIFT)
+                {
+                node->entries.push_back(std::move(entry));
+                return;
+                }
+            std::uint32_t b = bit(hash, shift);
+            node->datamap |= b;
+            node->entries.insert(node->entries.begin() + index(node->datamap, b), std::move(entry));
+            }
+
+        //a node holding two entries that collided at the level above
+        static Ref split(std::pair<K, V> &&first, std::size_t first_hash, std::pair<K, V> &&second,
+                         std::size_t second_hash, unsigned shift)
+            {
+            Ref node(new Node());
+            if (shift < LEAF_SHIFT && bit(first_hash, shift) == bit(second_hash, shift))
+                {
+                std::uint32_t b = bit(first_hash, shift);
+                node->nodemap |= b;
+                node->children.push_back(
+                        split(std::move(first), first_hash, std::move(second), second_hash,
+                              shift + internal::persistent::BITS)
+                );
+                }
+            else
+                {
+                place(node.get(), first_hash, shift, std::move(first));
+                place(node.get(), second_hash, shift, std::move(second));
+                }
+            return node;
+            }
+
+        //true when key was not there yet
+        static bool insert(Ref &ref, std::size_t h, unsigned shift, const K &key, const V &value)
+            {
+            Node *node = ref.get();
+            if (shift >= LEAF_SHIFT)
+                {
+                for (auto &entry : node->entries)
+                    {
+                    if (Equal()(entry.first, key))
+                        {
+                        ref.own();
+                        for (auto &owned : ref->entries)
+                            {
+                            if (Equal()(owned.first, key))
+                                { owned.second = value; }
+                            }
+                        return false;
+                        }
+                    }
+                ref.own()->entries.emplace_back(key, value);
+                return true;
+                }
+
+            std::uint32_t b = bit(h, shift);
+            if (node->datamap & b)
+                {
+                unsigned at = index(node->datamap, b);
+                if (Equal()(node->entries[at].first, key))
+                    {
+                    ref.own()->entries[at].second = value;
+                    return false;
+                    }
+                node = ref.own();
+                std::pair<K, V> existing = std::move(node->entries[at]);
+                node->entries.erase(node->entries.begin() + at);
+                node->datamap ^= b;
+                std::size_t existing_hash = hash(existing.first);
+                node->nodemap |= b;
+                node->children.insert(
+                        node->children.begin() + index(node->nodemap, b),
+                        split(std::move(existing), existing_hash, std::pair<K, V>(key, value), h,
+                              shift + internal::persistent::BITS)
+                );
+                return true;
+                }
+            if (node->nodemap & b)
+                {
+                node = ref.own();
+                return insert(node->children[index(node->nodemap, b)], h, shift + internal::persistent::BITS, key, value);
+                }
+            place(ref.own(), h, shift, std::pair<K, V>(key, value));
+            return true;
+            }
+
+        //key has to be in the map, erase() looks for it first so a missing key copies no node that
+        //another copy shares. a child left with a single entry and no children is pulled up so every
+        //map with the same entries has the same shape
+        static void remove(Ref &ref, std::size_t h, unsigned shift, const K &key)
+            {
+            Node *node = ref.get();
+            if (shift >= LEAF_SHIFT)
+                {
+                for (std::size_t i = 0; i < node->entries.size(); i++)
+                    {
+                    if (Equal()(node->entries[i].first, key))
+                        {
+                        node = ref.own();
+                        node->entries.erase(node->entries.begin() + i);
+                        return;
+                        }
+                    }
+                return;
+                }
+
+            std::uint32_t b = bit(h, shift);
+            if (node->datamap & b)
+                {
+                node = ref.own();
+                node->entries.erase(node->entries.begin() + index(node->datamap, b));
+                node->datamap ^= b;
+                return;
+                }
+            if (node->nodemap & b)
+                {
+                unsigned at = index(node->nodemap, b);
+                node = ref.own();
+                remove(node->children[at], h, shift + internal::persistent::BITS, key);
+                Node *child = node->children[at].get();
+                if (child->children.empty() && child->entries.size() <= 1)
+                    {
+                    if (child->entries.size() == 1)
+                        {
+                        std::pair<K, V> entry = child->entries.front();
+                        node->children.erase(node->children.begin() + at);
+                        node->nodemap ^= b;
+                        place(node, h, shift, std::move(entry));
+                        }
+                    else
+                        {
+                        node->children.erase(node->children.begin() + at);
+                        node->nodemap ^= b;
+                        }
+                    }
+                }
+            }
+
+        template<class F>
+        static void visit(const Node *node, F &f)
+            {
+            for (const auto &entry : node->entries)
+                { f(entry.first, entry.second); }
+            for (const auto &child : node->children)
+                { visit(child.get(), f); }
+            }
+
+    public:
+        WPersistentMap()
+                : root(new Node()),
+                  count(0)
+            {}
+
+        //copying is as cheap as moving would be, without moves a moved from map stays usable
+        WPersistentMap(const WPersistentMap &) = default;
+        WPersistentMap &operator=(const WPersistentMap &) = default;
+
+        std::size_t size() const
+            { return count; }
+
+        bool empty() const
+            { return count == 0; }
+
+        //null when key is not in the map
+        const V *find(const K &key) const
+            {
+            std::size_t h = hash(key);
+            const Node *node = root.get();
+            for (unsigned shift = 0; shift < LEAF_SHIFT; shift += internal::persistent::BITS)
+                {
+                std::uint32_t b = bit(h, shift);
+                if (node->datamap & b)
+                    {
+                    const auto &entry = node->entries[index(node->datamap, b)];
+                    return Equal()(entry.first, key) ? &entry.second : nullptr;
+                    }
+                if (!(node->nodemap & b))
+                    { return nullptr; }
+                node = node->children[index(node->nodemap, b)].get();
+                }
+            for (const auto &entry : node->entries)
+                {
+                if (Equal()(entry.first, key))
+                    { return &entry.second; }
+                }
+            return nullptr;
+            }
+
+        bool contains(const K &key) const
+            { return find(key) != nullptr; }
+
+        //adds key or replaces its value
+        void set(const K &key, const V &value)
+            {
+            if (insert(root, hash(key), 0, key, value))
+                { count++; }
+            }
+
+        //looks for key without copying anything first, erasing a missing key leaves the map shared
+        void erase(const K &key)
+            {
+            if (find(key) == nullptr)
+                { return; }
+            remove(root, hash(key), 0, key);
+            count--;
+            }
+
+        //calls f(key, value) for every entry in no particular order
+        template<class F>
+        void for_each(F &&f) const
+            { visit(root.get(), f); }
+
+        //copies that were not written since share their root and compare in O(1)
+        bool operator==(const WPersistentMap &other) const
+            {
+            if (root.get() == other.root.get())
+                { return true; }
+            if (count != other.count)
+                { return false; }
+            bool equal = true;
+            for_each(
+                    [&other, &equal](const K &key, const V &value)
+                        {
+                        const V *found = other.find(key);
+                        equal = equal && found != nullptr && *found == value;
+                        }
+            );
+            return equal;
+            }
+
+        bool operator!=(const WPersistentMap &other) const
+            { return !(*this == other); }
+        };
+
+    //a persistent vector, a 32 way trie of the elements with the last up to 32 of them in a separate
+    //tail so push_back() mostly touches the tail alone. copies share all their nodes so copying is O(1),
+    //set(), push_back() and pop_back() copy the O(log n) nodes on their path that are still shared
+    template<class T>
+    class WPersistentVector
+        {
+    private:
+        //leaves use values, the nodes above them children
+        struct Node : internal::persistent::Counted
+            {
+            std::vector<internal::persistent::Ref<Node> > children;
+            std::vector<T> values;
+            };
+
+        typedef internal::persistent::Ref<Node> Ref;
+
+        Ref root;
+        Ref tail;
+        std::size_t count;
+        //of the leaves below root
+        unsigned shift;
+
+        std::size_t tail_offset() const
+            { return count - tail->values.size(); }
+
+        const Node *leaf_for(std::size_t index) const
+            {
+            if (index >= tail_offset())
+                { return tail.get(); }
+            const Node *node = root.get();
+            for (unsigned level = shift; level > 0; level -= internal::persistent::BITS)
+                { node = node->children[(index >> level) & internal::persistent::MASK].get(); }
+            return node;
+            }
+
+        //hangs leaf below ref as the last leaf of a trie whose leaves are level bits below it
+        static void push_leaf(Ref &ref, unsigned level, std::size_t index, Ref &&leaf)
+            {
+            Node *node = ref.own();
+            std::size_t at = (index >> level) & internal::persistent::MASK;
+            if (level == internal::persistent::BITS)
+                {
+                node->children.push_back(std::move(leaf));
+                return;
+                }
+            if (at == node->children.size())
+                { node->children.push_back(Ref(new Node())); }
+            push_leaf(node->children[at], level - internal::persistent::BITS, index, std::move(leaf));
+            }
+
+        //takes the last leaf out of the trie below ref, which is left without empty nodes
+        static Ref pop_leaf(Ref &ref, unsigned level)
+            {
+            Node *node = ref.own();
+            if (level == internal::persistent::BITS)
+                {
+                Ref leaf = std::move(node->children.back());
+                node->children.pop_back();
+                return leaf;
+                }
+            Ref leaf = pop_leaf(node->children.back(), level - internal::persistent::BITS);
+            if (node->children.back()->children.empty())
+                { node->children.pop_back(); }
+            return leaf;
+            }
+
+        static void update(Ref &ref, unsigned level, std::size_t index, const T &value)
+            {
+            Node *node = ref.own();
+            if (level == 0)
+                {
+                node->values[index & internal::persistent::MASK] = value;
+                return;
+                }
+            update(node->children[(index >> level) & internal::persistent::MASK], level - internal::persistent::BITS, index, value);
+            }
+
+        template<class F>
+        static void visit(const Node *node, unsigned level, F &f)
+            {
+            if (level == 0)
+                {
+                for (const T &value : node->values)
+                    { f(value); }
+                return;
+                }
+            for (const Ref &child : node->children)
+                { visit(child.get(), level - internal::persistent::BITS, f); }
+            }
+
+    public:
+        WPersistentVector()
+                : root(new Node()),
+                  tail(new Node()),
+                  count(0),
+                  shift(internal::persistent::BITS)
+            {}
+
+        WPersistentVector(const WPersistentVector &) = default;
+        WPersistentVector &operator=(const WPersistentVector &) = default;
+
+        std::size_t size() const
+            { return count; }
+
+        bool empty() const
+            { return count == 0; }
+
+        const T &operator[](std::size_t index) const
+            { return leaf_for(index)->values[index & internal::persistent::MASK]; }
+
+        const T &back() const
+            { return tail->values.back(); }
+
+        void set(std::size_t index, const T &value)
+            {
+            if (index >= tail_offset())
+                { tail.own()->values[index - tail_offset()] = value; }
+            else
+                { update(root, shift, index, value); }
+            }
+
+        void push_back(const T &value)
+            {
+            if (tail->values.size() == internal::persistent::WIDTH)
+                {
+                std::size_t offset = tail_offset();
+                //the trie is full, it becomes the first child of a new root
+                if ((offset >> internal::persistent::BITS) == (std::size_t(1) << shift))
+                    {
+                    Ref grown(new Node());
+                    grown->children.push_back(std::move(root));
+                    root = std::move(grown);
+                    shift += internal::persistent::BITS;
+                    }
+                push_leaf(root, shift, offset, std::move(tail));
+                tail = Ref(new Node());
+                }
+            tail.own()->values.push_back(value);
+            count++;
+            }
+
+        void pop_back()
+            {
+            if (tail->values.size() > 1 || count == 1)
+                {
+                tail.own()->values.pop_back();
+                count--;
+                return;
+                }
+            tail = pop_leaf(root, shift);
+            count--;
+            if (shift > internal::persistent::BITS && root->children.size() == 1)
+                {
+                Ref only = root->children.front();
+                root = std::move(only);
+                shift -= internal::persistent::BITS;
+                }
+            }
+
+        //calls f(value) for every element in order
+        template<class F>
+        void for_each(F &&f) const
+            {
+            visit(root.get(), shift, f);
+            for (const T &value : tail->values)
+                { f(value); }
+            }
+
+        //copies that were not written since share their nodes and compare in O(1)
+        bool operator==(const WPersistentVector &other) const
+            {
+            if (root.get() == other.root.get() && tail.get() == other.tail.get())
+                { return true; }
+            if (count != other.count)
+                { return false; }
+            for (std::size_t i = 0; i < count; i++)
+                {
+                if (!((*this)[i] == other[i]))
+                    { return false; }
+                }
+            return true;
+            }
+
+        bool operator!=(const WPersistentVector &other) const
+            { return !(*this == other); }
+        };
+    }
+
+#endif //WEVENTS_W_PERSISTENT_H
@@ -0,0 +1,335 @@
+#ifndef WEVENTS_W_POOL_H
+#define WEVENTS_W_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace wevents
+    {
+    struct WPoolStats
+        {
+        //requests made to the pool and how many of them actually had to go to operator new
+        std::size_t allocations;
+        std::size_t deallocations;
+        std::size_t system_allocations;
+        std::size_t bytes_reserved;
+
+        std::size_t saved() const
+            { return allocations - system_allocations; }
+
+        std::size_t in_use() const
+            { return allocations - deallocations; }
+        };
+
+    namespace internal
+        {
+        //size class allocator for the small objects created by connect() (connections, connection
+        //lists, slot object bookkeeping and async payloads). every thread keeps a cache of free blocks
+        //per size class and trades them with a shared free list in batches, slabs are never returned
+        namespace pool
+            {
+            const std::size_t GRANULARITY = 16;
+            const std::size_t MAX_SIZE = 256;
+            const std::size_t CLASSES = MAX_SIZE / GRANULARITY;
+            const std::size_t SLAB_SIZE = 16 * 1024;
+            const std::size_t BATCH = 32;
+
+            struct FreeNode
+                {
+                FreeNode *next;
+                };
+
+            class SizeClass
+                {
+            private:
+                std::mutex mutex;
+                FreeNode *free_list;
+                std::size_t block_size;
+
+            public:
+                std::atomic<std::size_t> allocations;
+                std::atomic<std::size_t> deallocations;
+                std::atomic<std::size_t> system_allocations;
+                std::atomic<std::size_t> bytes_reserved;
+
+                SizeClass()
+                        : free_list(nullptr),
+                          block_size(0),
+                          allocations(0),
+                          deallocations(0),
+                          system_allocations(0),
+                          bytes_reserved(0)
+                    {}
+
+                void set_block_size(std::size_t size)
+                    { block_size = size; }
+
+                //hands out up to BATCH blocks linked together, carving a new slab when the shared list is empty
+                FreeNode *take_batch(std::size_t &count)
+                    {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (free_list == nullptr)
+                        {
+                        char *slab = static_cast<char *>(::operator new(SLAB_SIZE));
+                        system_allocations.fetch_add(1, std::memory_order_relaxed);
+                        bytes_reserved.fetch_add(SLAB_SIZE, std::memory_order_relaxed);
+                        for (std::size_t offset = 0; offset + block_size <= SLAB_SIZE; offset += block_size)
+                            {
+                            FreeNode *node = reinterpret_cast<FreeNode *>(slab + offset);
+                            node->next = free_list;
+                            free_list = node;
+                            }
+                        }
+
+                    FreeNode *head = free_list;
+                    FreeNode *tail = head;
+                    count = 1;
+                    while (count < BATCH && tail->next != nullptr)
+                        {
+                        tail = tail->next;
+                        count++;
+                        }
+                    free_list = tail->next;
+                    tail->next = nullptr;
+                    return head;
+                    }
+
+                void give_batch(FreeNode *head, FreeNode *tail)
+                    {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    tail->next = free_list;
+                    free_list = head;
+                    }
+                };
+
+            class Pools
+                {
+            private:
+                SizeClass classes[CLASSES];
+
+            public:
+                std::atomic<std::size_t> oversized;
+                std::atomic<std::size_t> oversized_freed;
+
+                Pools()
+                        : oversized(0),
+                          oversized_freed(0)
+                    {
+                    for (std::size_t i = 0; i < CLASSES; i++)
+                        { classes[i].set_block_size((i + 1) * GRANULARITY); }
+                    }
+
+                SizeClass &get(std::size_t index)
+                    { return classes[index]; }
+                };
+
+            //never destroyed, blocks freed during static destruction still need somewhere to go
+            inline Pools &pools()
+                {
+                static Pools *instance = new Pools();
+                return *instance;
+                }
+
+            inline std::size_t class_index(std::size_t size)
+                { return (size == 0 ? 0 : (size - 1) / GRANULARITY); }
+
+            class ThreadCache
+                {
+            private:
+                FreeNode *heads[CLASSES];
+                std::size_t counts[CLASSES];
+
+            public:
+                ThreadCache()
+                    {
+                    for (std::size_t i = 0; i < CLASSES; i++)
+                        {
+                        heads[i] = nullptr;
+                        counts[i] = 0;
+                        }
+                    }
+
+                ~ThreadCache()
+                    {
+                    for (std::size_t i = 0; i < CLASSES; i++)
+                        { flush(i, counts[i]); }
+                    }
+
+                void *allocate(std::size_t index)
+                    {
+                    if (heads[index] == nullptr)
+                        { heads[index] = pools().get(index).take_batch(counts[index]); }
+                    FreeNode *node = heads[index];
+                    heads[index] = node->next;
+                    counts[index]--;
+                    return node;
+                    }
+
+                void deallocate(std::size_t index, void *ptr)
+                    {
+                    FreeNode *node = static_cast<FreeNode *>(ptr);
+                    node->next = heads[index];
+                    heads[index] = node;
+                    if (++counts[index] >= 2 * BATCH)
+                        { flush(index, BATCH); }
+                    }
+
+                //gives the first count cached blocks of a size class back to the shared list
+                void flush(std::size_t index, std::size_t count)
+                    {
+                    if (count == 0 || heads[index] == nullptr)
+                        { return; }
+                    FreeNode *head = heads[index];
+                    FreeNode *tail = head;
+                    for (std::size_t i = 1; i < count && tail->next != nullptr; i++)
+                        { tail = tail->next; }
+                    heads[index] = tail->next;
+                    counts[index] -= count;
+                    pools().get(index).give_batch(head, tail);
+                    }
+                };
+
+            inline ThreadCache *&thread_cache_slot()
+                {
+                static thread_local ThreadCache *cache = nullptr;
+                return cache;
+                }
+
+            class ThreadCacheHandle
+                {
+            private:
+                ThreadCache cache;
+
+            public:
+                ThreadCacheHandle()
+                    { thread_cache_slot() = &cache; }
+
+                ~ThreadCacheHandle()
+                    { thread_cache_slot() = nullptr; }
+                };
+
+            //null once the calling thread is tearing down, the shared lists are used directly then
+            inline ThreadCache *thread_cache()
+                {
+                static thread_local bool created = false;
+                if (!created)
+                    {
+                    created = true;
+                    static thread_local ThreadCacheHandle handle;
+                    }
+                return thread_cache_slot();
+                }
+
+            inline void *allocate(std::size_t size)
+                {
+                if (size > MAX_SIZE)
+                    {
+                    pools().oversized.fetch_add(1, std::memory_order_relaxed);
+                    return ::operator new(size);
+                    }
+
+                std::size_t index = class_index(size);
+                SizeClass &size_class = pools().get(index);
+                size_class.allocations.fetch_add(1, std::memory_order_relaxed);
+                if (ThreadCache *cache = thread_cache())
+                    { return cache->allocate(index); }
+
+                std::size_t count;
+                FreeNode *head = size_class.take_batch(count);
+                if (head->next != nullptr)
+                    {
+                    FreeNode *tail = head->next;
+                    while (tail->next != nullptr)
+                        { tail = tail->next; }
+                    size_class.give_batch(head->next, tail);
+                    }
+                return head;
+                }
+
+            inline void deallocate(void *ptr, std::size_t size)
+                {
+                if (ptr == nullptr)
+                    { return; }
+                if (size > MAX_SIZE)
+                    {
+                    pools().oversized_freed.fetch_add(1, std::memory_order_relaxed);
+                    ::operator delete(ptr);
+                    return;
+                    }
+
+                std::size_t index = class_index(size);
+                SizeClass &size_class = pools().get(index);
+                size_class.deallocations.fetch_add(1, std::memory_order_relaxed);
+                if (ThreadCache *cache = thread_cache())
+                    { cache->deallocate(index, ptr); }
+                else
+                    {
+                    FreeNode *node = static_cast<FreeNode *>(ptr);
+                    size_class.give_batch(node, node);
+                    }
+                }
+
+            //gives a class pooled operator new/delete
+            struct Pooled
+                {
+                static void *operator new(std::size_t size)
+                    { return allocate(size); }
+
+                static void operator delete(void *ptr, std::size_t size)
+                    { deallocate(ptr, size); }
+                };
+
+            //std allocator on top of the pools for node based containers
+            template<class T>
+            class Allocator
+                {
+            public:
+                typedef T value_type;
+
+                Allocator()
+                    {}
+
+                template<class U>
+                Allocator(const Allocator<U> &)
+                    {}
+
+                T *allocate(std::size_t n)
+                    { return static_cast<T *>(pool::allocate(n * sizeof(T))); }
+
+                void deallocate(T *ptr, std::size_t n)
+                    { pool::deallocate(ptr, n * sizeof(T)); }
+
+                template<class U>
+                bool operator==(const Allocator<U> &) const
+                    { return true; }
+
+                template<class U>
+                bool operator!=(const Allocator<U> &) const
+                    { return false; }
+                };
+            }
+        }
+
+    inline WPoolStats pool_stats()
+        {
+        WPoolStats stats = {0, 0, 0, 0};
+        for (std::size_t i = 0; i < internal::pool::CLASSES; i++)
+            {
+            internal::pool::SizeClass &size_class = internal::pool::pools().get(i);
+            stats.allocations += size_class.allocations.load(std::memory_order_relaxed);
+            stats.deallocations += size_class.deallocations.load(std::memory_order_relaxed);
+            stats.system_allocations += size_class.system_allocations.load(std::memory_order_relaxed);
+            stats.bytes_reserved += size_class.bytes_reserved.load(std::memory_order_relaxed);
+            }
+        std::size_t oversized = internal::pool::pools().oversized.load(std::memory_order_relaxed);
+        stats.allocations += oversized;
+        stats.system_allocations += oversized;
+        stats.deallocations += internal::pool::pools().oversized_freed.load(std::memory_order_relaxed);
+        return stats;
+        }
+    }
+
+#endif //WEVENTS_W_POOL_H
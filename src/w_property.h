@@ -10,18 +10,416 @@
 #include <type_traits>
 #include <functional>
 #include <tuple>
+#include <optional>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 
-#include "w_event(old).h"
+#include "w_event.h"
 
 namespace wevents
     {
-    template<class T>
+    //change detection policies, the second template argument of WProperty. a write or a recompute the
+    //policy calls unchanged notifies nobody and stops propagating right there. previous is null when
+    //the old value is not around anymore, like after operate() edited it in place
+
+    //every write counts as a change
+    struct WChangeAlways
+        {
+        template<class T>
+        bool unchanged(const T *, const T &)
+            { return false; }
+
+        void forget()
+            {}
+        };
+
+    //compares with operator==, needs the old value so in place edits always count as changes
+    struct WChangeEqual
+        {
+        template<class T>
+        bool unchanged(const T *previous, const T &current)
+            { return previous != nullptr && *previous == current; }
+
+        void forget()
+            {}
+        };
+
+    struct WFingerprintHash
+        {
+        template<class T>
+        std::size_t operator()(const T &value) const
+            { return std::hash<T>()(value); }
+        };
+
+    //remembers a hash of the last value, for large values the old copy is never needed and in place
+    //edits are detected too. two values with the same hash count as equal
+    template<class Hash = WFingerprintHash>
+    class WChangeFingerprint
+        {
+    private:
+        std::size_t fingerprint = 0;
+        bool known = false;
+
+    public:
+        template<class T>
+        bool unchanged(const T *, const T &current)
+            {
+            std::size_t updated = Hash()(current);
+            bool same = known && updated == fingerprint;
+            fingerprint = updated;
+            known = true;
+            return same;
+            }
+
+        //the value changed without being looked at
+        void forget()
+            { known = false; }
+        };
+
+    template<class T, class Change = WChangeAlways>
     class WProperty;
 
+    template<class F, class... Nodes>
+    class WExpr;
+
+    //when an expression property recomputes. an eager one does it as soon as an input changes,
+    //a lazy one only marks itself dirty and runs the expression on the next get() unless somebody
+    //is connected to its onChanged and needs the new value right away
+    enum class WEvaluation
+        {
+        EAGER,
+        LAZY,
+        };
+
     namespace internal
         {
         namespace property
             {
+            enum class Pass
+                {
+                MARK,
+                SETTLE,
+                KEEP,
+                //the alias chain through this property now ends at this property, which notifies its own changes
+                ANCHOR,
+                //the alias chain through this property now ends at another one, aliases count it as a change
+                REBIND,
+                };
+
+            class Propagation;
+
+            template<class T, class Change>
+            class PropertyBinding;
+
+            template<class Property>
+            class ExprInput;
+
+            //a WProperty as the propagation sees it, its dependents are connected to passes
+            class Node
+                {
+            private:
+                friend class Propagation;
+
+                template<class U, class C>
+                friend class PropertyBinding;
+
+                template<class Property>
+                friend class ExprInput;
+
+                //most properties have no dependents, so the signal is only allocated for the first one
+                WLazySignal<Pass> passes;
+                std::size_t pending = 0;
+                bool marked = false;
+                //its own value or one of its inputs changed during this propagation
+                bool modified = false;
+
+                //an input may change, expressions drop their cached value
+                virtual void invalidate() = 0;
+                //every changed input has settled, recompute if eager. false when the change detection
+                //policy found the new value to be the old one. may run on a worker thread
+                virtual bool prepare() = 0;
+                //notify subscribers after prepare() found a change
+                virtual void publish() = 0;
+                //none of the inputs actually changed, expressions take their cached value back
+                virtual void keep() = 0;
+                //computes lazy inputs so prepare() only reads them
+                virtual void pull() = 0;
+
+            protected:
+                Node()
+                    {}
+
+                void rebound(Pass pass)
+                    { passes.emit(pass); }
+
+                //for dependents of node types defined elsewhere, like WPropertyArray
+                WSignal<Pass> &propagation_passes()
+                    { return passes.get(); }
+
+            public:
+                virtual ~Node();
+                };
+
+            //a change goes out in two passes. the first marks everything downstream dirty and counts for
+            //every node how many of its inputs changed, the second settles a node once all of those
+            //have settled. that is a topological order of the affected nodes so each of them recomputes
+            //and notifies once per change no matter how many paths lead to it. nodes are settled a level
+            //at a time, everything in a level is prepared before any of it is published
+            class Propagation
+                {
+            private:
+                std::vector<Node *> ready;
+                std::vector<Node *> touched;
+                std::vector<Node *> level;
+                std::vector<std::size_t> work;
+                std::vector<unsigned char> results;
+                std::size_t held = 0;
+                bool running = false;
+                WExecutor *executor = nullptr;
+                std::size_t grain = 0;
+
+                //work holds indexes into level, every chunk of grain of them is prepared by whichever of the
+                //executor's workers or this thread gets to it first
+                void prepare_parallel()
+                    {
+                    struct Batch
+                        {
+                        std::atomic<std::size_t> next{0};
+                        std::atomic<std::size_t> done{0};
+                        std::mutex mutex;
+                        std::condition_variable finished;
+                        std::exception_ptr error;
+                        };
+
+                    for (std::size_t index : work)
+                        { level[index]->pull(); }
+
+                    auto batch = std::make_shared<Batch>();
+                    Node **nodes = level.data();
+                    unsigned char *prepared = results.data();
+                    const std::size_t *indexes = work.data();
+                    std::size_t count = work.size();
+                    std::size_t size = grain;
+                    std::size_t chunks = (count + size - 1) / size;
+                    auto drain = [batch, nodes, prepared, indexes, count, size, chunks]()
+                        {
+                        std::size_t chunk;
+                        while ((chunk = batch->next.fetch_add(1)) < chunks)
+                            {
+                            try
+                                {
+                                std::size_t end = std::min(count, (chunk + 1) * size);
+                                for (std::size_t i = chunk * size; i < end; i++)
+                                    { prepared[indexes[i]] = nodes[indexes[i]]->prepare(); }
+                                }
+                            catch (...)
+                                {
+                                std::lock_guard<std::mutex> lock(batch->mutex);
+                                if (!batch->error)
+                                    { batch->error = std::current_exception(); }
+                                }
+                            if (batch->done.fetch_add(1) + 1 == chunks)
+                                {
+                                std::lock_guard<std::mutex> lock(batch->mutex);
+                                batch->finished.notify_all();
+                                }
+                            }
+                        };
+
+                    for (std::size_t i = 1; i < chunks; i++)
+                        { executor->execute(drain); }
+                    drain();
+
+                    std::unique_lock<std::mutex> lock(batch->mutex);
+                    batch->finished.wait(lock, [&batch, chunks]()
+                        { return batch->done.load() == chunks; });
+                    if (batch->error)
+                        { std::rethrow_exception(batch->error); }
+                    }
+
+                void settle_level(std::size_t begin, std::size_t end)
+                    {
+                    level.clear();
+                    work.clear();
+                    for (std::size_t i = begin; i < end; i++)
+                        {
+                        Node *node = ready[i];
+                        if (node != nullptr && node->marked)
+                            {
+                            node->marked = false;
+                            node->pending = 0;
+                            if (node->modified)
+                                { work.push_back(level.size()); }
+                            else
+                                { node->keep(); }
+                            node->modified = false;
+                            level.push_back(node);
+                            }
+                        }
+
+                    results.assign(level.size(), 0);
+                    if (executor != nullptr && work.size() > grain)
+                        { prepare_parallel(); }
+                    else
+                        {
+                        for (std::size_t index : work)
+                            { results[index] = level[index]->prepare(); }
+                        }
+
+                    for (std::size_t i = 0; i < level.size(); i++)
+                        {
+                        Node *node = level[i];
+                        if (node == nullptr)
+                            { continue; }
+                        if (results[i])
+                            { node->publish(); }
+                        node->passes.emit(results[i] ? Pass::SETTLE : Pass::KEEP);
+                        }
+                    }
+
+                void reset()
+                    {
+                    for (Node *node : touched)
+                        {
+                        if (node != nullptr)
+                            {
+                            node->marked = false;
+                            node->modified = false;
+                            node->pending = 0;
+                            }
+                        }
+                    ready.clear();
+                    touched.clear();
+                    running = false;
+                    }
+
+                void run()
+                    {
+                    running = true;
+                    try
+                        {
+                        std::size_t next = 0;
+                        std::size_t scanned = 0;
+                        for (;;)
+                            {
+                            while (next < ready.size())
+                                {
+                                std::size_t end = ready.size();
+                                settle_level(next, end);
+                                next = end;
+                                }
+
+                            //an input deleted or rebound halfway never settles for its dependents,
+                            //those are let through in the order they were marked
+                            while (scanned < touched.size() &&
+                                   (touched[scanned] == nullptr || !touched[scanned]->marked))
+                                { scanned++; }
+                            if (scanned == touched.size())
+                                { break; }
+                            touched[scanned]->modified = true;
+                            ready.push_back(touched[scanned]);
+                            }
+                        }
+                    catch (...)
+                        {
+                        reset();
+                        throw;
+                        }
+                    reset();
+                    }
+
+            public:
+                static Propagation &current()
+                    {
+                    thread_local Propagation propagation;
+                    return propagation;
+                    }
+
+                //node's own value changed. a change made while another one is settling joins it
+                void changed(Node *node)
+                    {
+                    node->modified = true;
+                    if (!node->marked)
+                        {
+                        node->marked = true;
+                        touched.push_back(node);
+                        node->passes.emit(Pass::MARK);
+                        node->pending = 0;
+                        ready.push_back(node);
+                        }
+                    if (!running && held == 0)
+                        { run(); }
+                    }
+
+                //changes only mark until the last hold is released, then they settle together
+                void hold()
+                    { held++; }
+
+                void release()
+                    {
+                    if (--held == 0 && !running && !touched.empty())
+                        { run(); }
+                    }
+
+                //one of node's inputs changed
+                void mark(Node *node)
+                    {
+                    node->invalidate();
+                    node->pending++;
+                    if (!node->marked)
+                        {
+                        node->marked = true;
+                        touched.push_back(node);
+                        node->passes.emit(Pass::MARK);
+                        }
+                    }
+
+                //one of node's marked inputs settled, modified or kept its value
+                void settled(Node *node, bool modified)
+                    {
+                    if (node->marked && node->pending > 0)
+                        {
+                        node->modified |= modified;
+                        if (--node->pending == 0)
+                            { ready.push_back(node); }
+                        }
+                    }
+
+                void forget(Node *node)
+                    {
+                    std::replace(ready.begin(), ready.end(), node, static_cast<Node *>(nullptr));
+                    std::replace(touched.begin(), touched.end(), node, static_cast<Node *>(nullptr));
+                    std::replace(level.begin(), level.end(), node, static_cast<Node *>(nullptr));
+                    }
+
+                bool is_running() const
+                    { return running; }
+
+                //null executor settles everything on the changing thread
+                void parallel(WExecutor *executor, std::size_t grain)
+                    {
+                    this->executor = executor;
+                    this->grain = grain == 0 ? 1 : grain;
+                    }
+
+                WExecutor *parallel_executor() const
+                    { return executor; }
+
+                std::size_t parallel_grain() const
+                    { return grain; }
+                };
+
+            //a marked node is still listed by a propagation a transaction holds back
+            inline Node::~Node()
+                {
+                Propagation &propagation = Propagation::current();
+                if (marked || propagation.is_running())
+                    { propagation.forget(this); }
+                }
+
             template<class T>
             class ValueBase
                 {
@@ -35,6 +433,18 @@ namespace wevents
 
                 virtual const T &get_immutable() const = 0;
                 virtual T &get_mutable() = 0;
+
+                virtual void invalidate()
+                    {}
+
+                virtual bool settle()
+                    { return true; }
+
+                virtual void keep()
+                    {}
+
+                virtual void pull()
+                    {}
                 };
 
             template<class T>
@@ -72,10 +482,10 @@ namespace wevents
                     {}
 
                 const T &get_immutable() const
-                    { return value; }
+                    { return *value; }
 
                 T &get_mutable()
-                    { return *(value.get()); }
+                    { return *value; }
                 };
 
             template<class T>
@@ -102,252 +512,640 @@ namespace wevents
                     }
                 };
 
-            template<class T>
+            //alias of binding held as the value of owner. reads and changes come straight from source, the
+            //end of the alias chain, which is looked up again whenever binding gets rebound
+            template<class T, class Change>
             class PropertyBinding : public ImmutableValue<T>, public WSlotObject
                 {
             private:
-                WProperty<T> *binding;
+                template<class U, class C>
+                friend class wevents::WProperty;
 
-                void SLOT_property_deleted(const WProperty<T> &value)
-                    { this->get_mutable(); }
+                WProperty<T, Change> *binding;
+                WProperty<T, Change> *owner;
+                WProperty<T, Change> *source;
+                WConnection source_connection;
 
-            public:
-                PropertyBinding(ValueBase<T> **value_ref, WProperty<T> *binding, WProperty<T> *parent)
-                        : ImmutableValue<T>(value_ref),
-                          binding(binding)
+                //owner keeps the last value, its own aliases move their source over to it
+                void SLOT_property_deleted(const WProperty<T, Change> &)
+                    { owner->localize(); }
+
+                bool resolve()
                     {
-                    connect(binding->onDeleted, &PropertyBinding<T>::SLOT_property_deleted, this);
-                    connect(
-                            binding->onChanged, [&](const T &value)
-                                { parent->onChanged.emit(this->get_immutable()); }, this
-                    );
+                    WProperty<T, Change> *resolved = binding->source();
+                    if (resolved == source)
+                        { return false; }
+                    source_connection.disconnect();
+                    source = resolved;
+                    if (source != binding)
+                        { source_connection = connect(source->passes, &PropertyBinding<T, Change>::SLOT_source_pass, this); }
+                    return true;
+                    }
+
+                void SLOT_source_pass(Pass pass)
+                    {
+                    if (pass == Pass::MARK)
+                        { Propagation::current().mark(owner); }
+                    else if (pass == Pass::SETTLE || pass == Pass::KEEP)
+                        { Propagation::current().settled(owner, pass == Pass::SETTLE); }
+                    }
+
+                //binding itself is only listened to for propagation when it is the source
+                void SLOT_binding_pass(Pass pass)
+                    {
+                    if (pass == Pass::ANCHOR || pass == Pass::REBIND)
+                        {
+                        if (resolve())
+                            {
+                            owner->rebound(pass);
+                            if (pass == Pass::REBIND)
+                                { Propagation::current().changed(owner); }
+                            }
+                        }
+                    else if (source == binding)
+                        { SLOT_source_pass(pass); }
                     }
 
-                PropertyBinding(
-                        ValueBase<T> **value_ref,
-                        WProperty<T> *binding,
-                        std::function<void(const T &)> callback
-                               )
+            public:
+                PropertyBinding(ValueBase<T> **value_ref, WProperty<T, Change> *binding, WProperty<T, Change> *owner)
                         : ImmutableValue<T>(value_ref),
-                          binding(binding)
+                          binding(binding),
+                          owner(owner),
+                          source(nullptr)
                     {
-                    connect(binding->onDeleted, &PropertyBinding<T>::SLOT_property_deleted, this);
-                    connect(binding->onChanged, callback, this);
+                    connect(binding->onDeleted, &PropertyBinding<T, Change>::SLOT_property_deleted, this);
+                    connect(binding->passes, &PropertyBinding<T, Change>::SLOT_binding_pass, this);
+                    resolve();
                     }
 
+                //the old value is gone, only a fingerprint can tell
+                bool settle()
+                    { return !owner->change.unchanged(static_cast<const T *>(nullptr), source->get()); }
+
+                void pull()
+                    { source->get(); }
+
                 const T &get_immutable() const
-                    { return binding->get(); }
+                    { return source->get(); }
                 };
 
-            template<class Signature>
-            class ExprBinding;
+            //leaf of a WExpr reading a property, keeps a copy of the last value once the property is deleted
+            template<class Property>
+            class ExprInput
+                {
+            public:
+                typedef typename Property::value_type value_type;
 
-            template<std::size_t N, typename... Ts> using NthTypeOf = typename std::tuple_element<N,
-                                                                                                  std::tuple<Ts...>>::type;
+            private:
+                Property *property;
+                std::optional<value_type> detached;
+                bool changed;
 
-            template<std::size_t count>
-            struct connect_all
-                {
-                template<class T, class... Args>
-                static inline void run(
-                        ExprBinding<T(Args...)> *value,
-                        std::tuple<ValueBase<Args> *...> &result,
-                        std::tuple<WProperty<Args> *...> &args
-                                      )
+            public:
+                explicit ExprInput(Property *property)
+                        : property(property),
+                          changed(false)
+                    {}
+
+                const value_type &get() const
+                    { return property != nullptr ? property->get() : *detached; }
+
+                //whether the property settled with a change since the last call
+                bool take_changed()
                     {
-                    std::get<count - 1>(result) = new PropertyBinding<NthTypeOf<count - 1, Args...> >(
-                            &(std::get<count - 1>(result)),
-                            std::get<count - 1>(args),
-                            ([=](auto arg)
-                                { value->value_update(); })
-                    );
-                    connect_all<count - 1>::run(value, result, args);
+                    bool result = changed;
+                    changed = false;
+                    return result;
                     }
-                };
 
-            template<>
-            struct connect_all<0>
-                {
-                template<class T, class... Args>
-                static inline void run(
-                        ExprBinding<T(Args...)> *value,
-                        std::tuple<ValueBase<Args> *...> &result,
-                        std::tuple<WProperty<Args> *...> &args
-                                      )
-                    {}
-                };
+                template<class Visitor>
+                void visit(Visitor &&visitor)
+                    { visitor(*this); }
 
-            template<std::size_t size>
-            struct call
-                {
-                template<class T, class... Args, class... Collection>
-                static T run(
-                        std::function<T(Args...)> expr,
-                        std::tuple<ValueBase<Args> *...> &args,
-                        Collection &&... collection
-                            )
+                //dependent is the property holding the expression, slots is the binding owning this copy
+                void attach(Node *dependent, WSlotObject *slots)
                     {
-                    return call<size - 1>::run(
-                            expr,
-                            args,
-                            std::get<size - 1>(args)->get_immutable(),
-                            std::forward<Collection>(collection)...
+                    if (property == nullptr)
+                        { return; }
+                    connect(
+                            property->passes, [this, dependent](Pass pass)
+                                {
+                                if (pass == Pass::MARK)
+                                    { Propagation::current().mark(dependent); }
+                                else if (pass == Pass::SETTLE || pass == Pass::KEEP)
+                                    {
+                                    changed |= pass == Pass::SETTLE;
+                                    Propagation::current().settled(dependent, pass == Pass::SETTLE);
+                                    }
+                                }, slots
+                    );
+                    connect(
+                            property->onDeleted, [this](const Property &deleted)
+                                {
+                                detached = deleted.get();
+                                property = nullptr;
+                                }, slots
                     );
                     }
                 };
 
-            template<>
-            struct call<0>
+            //plain value used as an operand, like the 2 in a * 2
+            template<class T>
+            class ExprConstant
                 {
-                template<class T, class... Args, class... Collection>
-                static T run(
-                        std::function<T(Args...)> expr,
-                        std::tuple<ValueBase<Args> *...> &args,
-                        Collection &&... collection
-                            )
-                    { return expr(std::forward<Collection>(collection)...); }
-                };
+            private:
+                T value;
 
-            template<std::size_t count>
-            struct delete_tuple
-                {
-                template<class... Args>
-                static inline void run(std::tuple<Args *...> &tuple)
-                    {
-                    delete std::get<count - 1>(tuple);
-                    delete_tuple<count - 1>::run(tuple);
-                    }
-                };
+            public:
+                typedef T value_type;
 
-            template<>
-            struct delete_tuple<0>
-                {
-                template<class... Args>
-                static inline void run(std::tuple<Args *...> &tuple)
+                explicit ExprConstant(T value)
+                        : value(std::move(value))
+                    {}
+
+                const T &get() const
+                    { return value; }
+
+                template<class Visitor>
+                void visit(Visitor &&)
                     {}
                 };
 
-            template<class T, class... Args>
-            class ExprBinding<T(Args...)> : public ImmutableValue<T>, public WSlotObject
+            template<class T>
+            struct is_expr_operand
+                    : std::false_type
+                {};
+
+            template<class T, class Change>
+            struct is_expr_operand<WProperty<T, Change> >
+                    : std::true_type
+                {};
+
+            template<class F, class... Nodes>
+            struct is_expr_operand<WExpr<F, Nodes...> >
+                    : std::true_type
+                {};
+
+            //specialized by w_property_array.h, the scalar operators step aside when either side is an array
+            template<class T>
+            struct is_array_operand
+                    : std::false_type
+                {};
+
+            template<class T, class Change>
+            inline ExprInput<WProperty<T, Change> > expr_node(WProperty<T, Change> &property)
+                { return ExprInput<WProperty<T, Change> >(&property); }
+
+            template<class F, class... Nodes>
+            inline WExpr<F, Nodes...> expr_node(const WExpr<F, Nodes...> &expr)
+                { return expr; }
+
+            template<class V, class = typename std::enable_if<!is_expr_operand<typename std::decay<V>::type>::value>::type>
+            inline ExprConstant<typename std::decay<V>::type> expr_node(V &&value)
+                { return ExprConstant<typename std::decay<V>::type>(std::forward<V>(value)); }
+
+            //value of a property computed from a WExpr. the expression is copied in, so its inputs are
+            //read straight from the properties and the function is called without any indirection
+            template<class T, class Change, class Expr>
+            class ExprBinding : public ImmutableValue<T>, public WSlotObject
                 {
             private:
-                typedef std::function<T(Args...)> func_type;
+                Expr expr;
+                mutable std::optional<T> value;
+                mutable bool dirty;
+                //dirty only because an input was marked, the cached value is still good if none changes
+                mutable bool provisional;
+                WProperty<T, Change> *parent;
 
-                std::tuple<ValueBase<Args> *...> bindings;
-                std::unique_ptr<T> value;
-                WProperty<T> *parent;
-                func_type expr;
+                T evaluate() const
+                    {
+                    internal::trace::Span span("WProperty recompute");
+                    return expr.get();
+                    }
 
-                static const std::size_t argNum = sizeof...(Args);
+                //assigns into the cached value so types like int never touch the heap
+                void recompute() const
+                    {
+                    value = evaluate();
+                    dirty = false;
+                    provisional = false;
+                    }
 
             public:
-                ExprBinding(ValueBase<T> **value_ref, WProperty<T> *parent, func_type expr, WProperty<Args> &... args)
+                ExprBinding(ValueBase<T> **value_ref, WProperty<T, Change> *parent, const Expr &expr)
                         : ImmutableValue<T>(value_ref),
                           expr(expr),
+                          dirty(true),
+                          provisional(false),
                           parent(parent)
                     {
-                    auto args_tuple = std::make_tuple<WProperty<Args> *...>((&args)...);
-                    connect_all<argNum>::run/*<T, Args...>*/(this, bindings, args_tuple);
-                    value = std::make_unique<T>(call<sizeof...(Args)>::run(expr, bindings));
+                    this->expr.visit(
+                            [this](auto &input)
+                                { input.attach(this->parent, this); }
+                    );
+                    if (parent->get_evaluation() == WEvaluation::EAGER)
+                        { recompute(); }
                     }
 
-                void value_update()
+                void invalidate()
                     {
-                    value = std::make_unique<T>(call<sizeof...(Args)>::run(expr, bindings));
-                    parent->onChanged.emit(get_immutable());
+                    if (!dirty)
+                        {
+                        dirty = true;
+                        provisional = true;
+                        }
+                    }
+
+                //a lazy expression or one somebody already pulled is not compared, it counts as changed
+                bool settle()
+                    {
+                    provisional = false;
+                    if (!dirty || parent->get_evaluation() == WEvaluation::LAZY)
+                        {
+                        parent->change.forget();
+                        return true;
+                        }
+
+                    T updated = evaluate();
+                    dirty = false;
+                    bool unchanged = parent->change.unchanged(value ? &*value : nullptr, updated);
+                    value = std::move(updated);
+                    return !unchanged;
+                    }
+
+                void keep()
+                    {
+                    if (provisional)
+                        {
+                        dirty = false;
+                        provisional = false;
+                        }
+                    }
+
+                void pull()
+                    {
+                    expr.visit(
+                            [](auto &input)
+                                { input.get(); }
+                    );
                     }
 
                 const T &get_immutable() const
-                    { return *value; }
+                    {
+                    if (dirty)
+                        { recompute(); }
+                    return *value;
+                    }
                 };
             }
         }
 
-    template<class T>
-    class WProperty
+    //a function of properties, other expressions and constants, built by make_expr() or the arithmetic
+    //operators and turned into a binding by assigning it to a WProperty. its type spells out the whole
+    //expression so evaluating it compiles down to the function applied to the inputs
+    template<class F, class... Nodes>
+    class WExpr
+        {
+    private:
+        template<class G, class... Others>
+        friend class WExpr;
+
+        F function;
+        std::tuple<Nodes...> nodes;
+
+    public:
+        typedef typename std::decay<
+                typename std::invoke_result<const F &, const typename Nodes::value_type &...>::type>::type value_type;
+
+        WExpr(F function, Nodes... nodes)
+                : function(std::move(function)),
+                  nodes(std::move(nodes)...)
+            {}
+
+        value_type get() const
+            {
+            return std::apply(
+                    [this](const Nodes &... node)
+                        { return function(node.get()...); }, nodes
+            );
+            }
+
+        template<class Visitor>
+        void visit(Visitor &&visitor)
+            {
+            std::apply(
+                    [&visitor](Nodes &... node)
+                        { (node.visit(visitor), ...); }, nodes
+            );
+            }
+        };
+
+    //operands can be properties, expressions or plain values
+    template<class F, class... Operands>
+    inline WExpr<typename std::decay<F>::type, decltype(internal::property::expr_node(std::declval<Operands>()))...>
+    make_expr(F &&function, Operands &&... operands)
+        {
+        return WExpr<typename std::decay<F>::type, decltype(internal::property::expr_node(std::declval<Operands>()))...>(
+                std::forward<F>(function),
+                internal::property::expr_node(std::forward<Operands>(operands))...
+        );
+        }
+
+#define WEVENTS_EXPR_OPERATOR(op, function) \
+    template<class L, class R, class = typename std::enable_if< \
+            (internal::property::is_expr_operand<typename std::decay<L>::type>::value || \
+             internal::property::is_expr_operand<typename std::decay<R>::type>::value) && \
+            !internal::property::is_array_operand<typename std::decay<L>::type>::value && \
+            !internal::property::is_array_operand<typename std::decay<R>::type>::value>::type> \
+    inline auto operator op(L &&left, R &&right) \
+        { return make_expr(function(), std::forward<L>(left), std::forward<R>(right)); }
+
+    WEVENTS_EXPR_OPERATOR(+, std::plus<>)
+    WEVENTS_EXPR_OPERATOR(-, std::minus<>)
+    WEVENTS_EXPR_OPERATOR(*, std::multiplies<>)
+    WEVENTS_EXPR_OPERATOR(/, std::divides<>)
+    WEVENTS_EXPR_OPERATOR(%, std::modulus<>)
+
+#undef WEVENTS_EXPR_OPERATOR
+
+    //while one is alive on a thread, property changes made on it only mark their dependents dirty.
+    //when the outermost one commits every affected property recomputes and notifies once
+    class WPropertyTransaction
+        {
+    private:
+        bool open;
+
+    public:
+        WPropertyTransaction()
+                : open(true)
+            { internal::property::Propagation::current().hold(); }
+
+        WPropertyTransaction(const WPropertyTransaction &) = delete;
+        WPropertyTransaction &operator=(const WPropertyTransaction &) = delete;
+
+        ~WPropertyTransaction()
+            { commit(); }
+
+        void commit()
+            {
+            if (open)
+                {
+                open = false;
+                internal::property::Propagation::current().release();
+                }
+            }
+        };
+
+    //while one is alive on a thread, the expressions of each level of a change propagating on it are
+    //recomputed in chunks of grain on executor. a level with no more than grain of them to recompute
+    //stays on the changing thread. signals are still emitted there, level by level once the whole level
+    //is computed. expressions of a level run concurrently so they must only read their inputs
+    class WParallelPropagation
         {
     private:
+        WExecutor *previous_executor;
+        std::size_t previous_grain;
+
+    public:
+        explicit WParallelPropagation(WExecutor &executor = WThreadPool::shared(), std::size_t grain = 16)
+            {
+            internal::property::Propagation &propagation = internal::property::Propagation::current();
+            previous_executor = propagation.parallel_executor();
+            previous_grain = propagation.parallel_grain();
+            propagation.parallel(&executor, grain);
+            }
+
+        WParallelPropagation(const WParallelPropagation &) = delete;
+        WParallelPropagation &operator=(const WParallelPropagation &) = delete;
+
+        ~WParallelPropagation()
+            { internal::property::Propagation::current().parallel(previous_executor, previous_grain); }
+        };
+
+    //Change decides which writes and recomputes count as changes, see WChangeAlways, WChangeEqual and
+    //WChangeFingerprint
+    template<class T, class Change>
+    class WProperty : public internal::property::Node
+        {
+    private:
+        template<class U, class C>
+        friend class internal::property::PropertyBinding;
+
+        template<class U, class C, class Expr>
+        friend class internal::property::ExprBinding;
+
+        template<class F, class... Nodes>
+        internal::property::ValueBase<T> *bind_expr(const WExpr<F, Nodes...> &expr)
+            { return new internal::property::ExprBinding<T, Change, WExpr<F, Nodes...> >(&value, this, expr); }
+
+        //a plain value lives in local and value is null, otherwise local is not constructed and value
+        //is the binding, expression or owned pointer producing it
+        union
+            {
+            T local;
+            };
         internal::property::ValueBase<T> *value;
+        WEvaluation evaluation = WEvaluation::EAGER;
+        Change change;
+
+        WProperty<T, Change> *source()
+            {
+            auto *alias = dynamic_cast<internal::property::PropertyBinding<T, Change> *>(value);
+            return alias != nullptr ? alias->source : this;
+            }
+
+        void changed()
+            { internal::property::Propagation::current().changed(this); }
+
+        void invalidate()
+            {
+            if (value != nullptr)
+                { value->invalidate(); }
+            }
+
+        bool prepare()
+            { return value == nullptr || value->settle(); }
+
+        //the value itself is only produced when somebody is connected to onChanged
+        void publish()
+            {
+            onInvalidated.emit();
+            if (onChanged.has_connections())
+                { onChanged.emit(get()); }
+            }
+
+        void pull()
+            {
+            if (value != nullptr)
+                { value->pull(); }
+            }
+
+        void keep()
+            {
+            if (value != nullptr)
+                { value->keep(); }
+            }
+
+        void release_value()
+            {
+            if (value == nullptr)
+                { local.~T(); }
+            else
+                { delete value; }
+            }
+
+        //the old value may be a binding, dropping it also stops it from propagating into this property.
+        //aliases of this one settle together with it
+        void replace(internal::property::ValueBase<T> *replacement)
+            {
+            WPropertyTransaction batch;
+            release_value();
+            value = replacement;
+            change.forget();
+            rebound(source() == this ? internal::property::Pass::ANCHOR : internal::property::Pass::REBIND);
+            changed();
+            }
+
+        //eq may live inside the binding being dropped so it is copied out first
+        template<class U>
+        void assign(U &&eq)
+            {
+            if (value == nullptr)
+                {
+                if (change.unchanged(&local, static_cast<const T &>(eq)))
+                    { return; }
+                local = std::forward<U>(eq);
+                }
+            else
+                {
+                internal::property::ValueBase<T> *old = value;
+                bool same = change.unchanged(&old->get_immutable(), static_cast<const T &>(eq));
+                new(&local) T(std::forward<U>(eq));
+                value = nullptr;
+                delete old;
+                rebound(internal::property::Pass::ANCHOR);
+                if (same)
+                    { return; }
+                }
+            changed();
+            }
+
+        T &localize()
+            {
+            if (value != nullptr)
+                {
+                internal::property::ValueBase<T> *old = value;
+                new(&local) T(old->get_immutable());
+                value = nullptr;
+                delete old;
+                rebound(internal::property::Pass::ANCHOR);
+                }
+            return local;
+            }
 
     public:
+        typedef T value_type;
+        typedef Change change_type;
+
         WProperty(const T &copy)
-                : value(new internal::property::MutableValue<T>(copy))
-            {}
+                : local(copy),
+                  value(nullptr)
+            { change.unchanged(static_cast<const T *>(nullptr), local); }
 
         WProperty(T &&move)
-                : value(new internal::property::MutableValue<T>(std::move(move)))
-            {}
+                : local(std::move(move)),
+                  value(nullptr)
+            { change.unchanged(static_cast<const T *>(nullptr), local); }
 
         WProperty(T *&&moveptr)
                 : value(new internal::property::MutableValuePointer<T>(std::move(moveptr)))
             {}
 
-        WProperty(WProperty<T> &binding)
-            { this->value = new internal::property::PropertyBinding<T>(&value, &binding, this); }
+        WProperty(WProperty<T, Change> &binding)
+            { this->value = new internal::property::PropertyBinding<T, Change>(&value, &binding, this); }
 
-        template<class... Args>
+        template<class... Properties>
         WProperty(
-                typename internal::events::Identity<std::function<T(Args...)> >::type callback,
-                WProperty<Args> &... args
+                typename internal::events::Identity<
+                        std::function<T(typename Properties::value_type...)> >::type callback,
+                Properties &... args
                  )
-            { this->value = new internal::property::ExprBinding<T(Args...)>(&value, this, callback, args...); }
+            { this->value = bind_expr(make_expr(std::move(callback), args...)); }
+
+        template<class F, class... Nodes>
+        WProperty(const WExpr<F, Nodes...> &expr)
+            { this->value = bind_expr(expr); }
 
         ~WProperty()
             {
             onDeleted.emit(*this);
-            delete value;
+            release_value();
             }
 
-        WSignal<const T &> onChanged;
-        WSignal<const WProperty<T> &> onDeleted;
+        //eager subscribers, connecting here makes a lazy property compute every change right away
+        WLazySignal<const T &> onChanged;
+        //lazy subscribers, fired on every change without producing the new value
+        WLazySignal<> onInvalidated;
+        WLazySignal<const WProperty<T, Change> &> onDeleted;
+
+        //only affects expressions, the new mode is used from the next change on
+        void set_evaluation(WEvaluation mode)
+            { evaluation = mode; }
+
+        WEvaluation get_evaluation() const
+            { return evaluation; }
 
         void operate(std::function<void(typename std::add_lvalue_reference<T>::type)> func)
             {
-            func(value->get_mutable());
-            onChanged.emit(value->get_immutable());
+            func(localize());
+            if (!change.unchanged(static_cast<const T *>(nullptr), local))
+                { changed(); }
             }
 
-        WProperty<T> &operator=(const T &eq)
+        WProperty<T, Change> &operator=(const T &eq)
             {
-            value = new internal::property::MutableValue<T>(eq);
-            onChanged.emit(value->get_immutable());
+            assign(eq);
             return *this;
             }
 
-        WProperty<T> &operator=(T &&eq)
+        WProperty<T, Change> &operator=(T &&eq)
             {
-            value = new internal::property::MutableValue<T>(std::move(eq));
-            onChanged.emit(value->get_immutable());
+            assign(std::move(eq));
             return *this;
             }
 
-        WProperty<T> &operator=(T *&&eq)
+        WProperty<T, Change> &operator=(T *&&eq)
             {
-            value = new internal::property::MutableValuePointer<T>(std::move(eq));
-            onChanged.emit(value->get_immutable());
+            replace(new internal::property::MutableValuePointer<T>(std::move(eq)));
             return *this;
             }
 
-        WProperty<T> &operator=(WProperty<T> &binding)
+        WProperty<T, Change> &operator=(WProperty<T, Change> &binding)
             {
-            this->value = new internal::property::PropertyBinding<T>(&value, &binding, this);
-            onChanged.emit(value->get_immutable());
+            replace(new internal::property::PropertyBinding<T, Change>(&value, &binding, this));
             return *this;
             }
 
-        template<class... Args>
-        WProperty<T> &set_expr(
-                typename internal::events::Identity<std::function<T(Args...)> >::type callback,
-                WProperty<Args> &... args
+        template<class... Properties>
+        WProperty<T, Change> &set_expr(
+                typename internal::events::Identity<
+                        std::function<T(typename Properties::value_type...)> >::type callback,
+                Properties &... args
                               )
             {
-            this->value = new internal::property::ExprBinding<T(Args...)>(&value, this, callback, args...);
-            onChanged.emit(value->get_immutable());
+            replace(bind_expr(make_expr(std::move(callback), args...)));
+            return *this;
+            }
+
+        template<class F, class... Nodes>
+        WProperty<T, Change> &operator=(const WExpr<F, Nodes...> &expr)
+            {
+            replace(bind_expr(expr));
             return *this;
             }
 
         const T &get() const
-            { return value->get_immutable(); }
+            { return value == nullptr ? local : value->get_immutable(); }
         };
     }
 
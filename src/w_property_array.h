@@ -0,0 +1,592 @@
+//
+// Created by Administrator on 9/23/2017.
+//
+
+#ifndef WGUI_W_PROPERTY_ARRAY_H
+#define WGUI_W_PROPERTY_ARRAY_H
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include "w_property.h"
+
+namespace wevents
+    {
+    template<class T>
+    class WPropertyArray;
+
+    template<class F, class... Nodes>
+    class WArrayExpr;
+
+    namespace internal
+        {
+        namespace property
+            {
+            //one bit per element of an array. the words that may hold set bits are kept as a range, so a
+            //change to a few elements of a large array is not a scan over all of them
+            class IndexBits
+                {
+            private:
+                std::vector<std::uint64_t> words;
+                std::size_t first = 0;
+                std::size_t last = 0;
+
+                void include(std::size_t begin, std::size_t end)
+                    {
+                    if (first == last)
+                        {
+                        first = begin;
+                        last = end;
+                        }
+                    else
+                        {
+                        first = std::min(first, begin);
+                        last = std::max(last, end);
+                        }
+                    }
+
+            public:
+                //clears every bit
+                void resize(std::size_t size)
+                    {
+                    words.assign((size + 63) / 64, 0);
+                    first = last = 0;
+                    }
+
+                void set(std::size_t index)
+                    {
+                    words[index / 64] |= std::uint64_t(1) << (index % 64);
+                    include(index / 64, index / 64 + 1);
+                    }
+
+                void clear()
+                    {
+                    std::fill(words.begin() + first, words.begin() + last, std::uint64_t(0));
+                    first = last = 0;
+                    }
+
+                //sets the first size bits
+                void fill(std::size_t size)
+                    {
+                    if (size == 0)
+                        { return; }
+                    std::fill(words.begin(), words.begin() + size / 64, ~std::uint64_t(0));
+                    if (size % 64 != 0)
+                        { words[size / 64] |= (std::uint64_t(1) << (size % 64)) - 1; }
+                    include(0, (size + 63) / 64);
+                    }
+
+                //drops every bit from size on
+                void trim(std::size_t size)
+                    {
+                    std::size_t count = (size + 63) / 64;
+                    if (words.size() > count)
+                        { words.resize(count); }
+                    if (size % 64 != 0 && words.size() == count)
+                        { words.back() &= (std::uint64_t(1) << (size % 64)) - 1; }
+                    last = std::min(last, count);
+                    if (first >= last)
+                        { first = last = 0; }
+                    }
+
+                void merge(const IndexBits &other)
+                    {
+                    if (other.first == other.last)
+                        { return; }
+                    if (words.size() < other.last)
+                        { words.resize(other.last, 0); }
+                    for (std::size_t i = other.first; i < other.last; i++)
+                        { words[i] |= other.words[i]; }
+                    include(other.first, other.last);
+                    }
+
+                void swap(IndexBits &other)
+                    {
+                    words.swap(other.words);
+                    std::swap(first, other.first);
+                    std::swap(last, other.last);
+                    }
+
+                bool any() const
+                    {
+                    for (std::size_t i = first; i < last; i++)
+                        {
+                        if (words[i] != 0)
+                            { return true; }
+                        }
+                    return false;
+                    }
+
+                //calls f(begin, end) for every run of consecutive set bits
+                template<class F>
+                void for_each_run(F &&f) const
+                    {
+                    bool inside = false;
+                    std::size_t start = 0;
+                    for (std::size_t w = first; w < last; w++)
+                        {
+                        //ones wherever the state flips next, from outside to inside a run or back
+                        std::uint64_t word = inside ? ~words[w] : words[w];
+                        std::size_t bit = 0;
+                        while (bit < 64 && (word >> bit) != 0)
+                            {
+                            bit += __builtin_ctzll(word >> bit);
+                            if (inside)
+                                { f(start, w * 64 + bit); }
+                            else
+                                { start = w * 64 + bit; }
+                            inside = !inside;
+                            word = ~word;
+                            }
+                        }
+                    if (inside)
+                        { f(start, last * 64); }
+                    }
+                };
+
+            //an array read by an array expression, dependent merges the elements it changed when it settles
+            template<class T>
+            class ArrayInput
+                {
+            private:
+                WPropertyArray<T> *array;
+                std::vector<T> detached;
+                const T *data;
+                IndexBits changes;
+
+            public:
+                typedef T value_type;
+
+                explicit ArrayInput(WPropertyArray<T> *array)
+                        : array(array),
+                          data(nullptr)
+                    {}
+
+                const T &get(std::size_t index) const
+                    { return data[index]; }
+
+                std::size_t size() const
+                    { return array != nullptr ? array->size() : detached.size(); }
+
+                //caches what get() reads from, called before every recompute
+                void bind()
+                    { data = array != nullptr ? array->data() : detached.data(); }
+
+                //adds the elements changed since the last call, true when all of them did
+                bool collect(IndexBits &changed)
+                    {
+                    changed.merge(changes);
+                    changes.clear();
+                    return false;
+                    }
+
+                void attach(Node *dependent, WSlotObject *slots)
+                    {
+                    connect(
+                            array->propagation_passes(), [this, dependent](Pass pass)
+                                {
+                                if (pass == Pass::MARK)
+                                    { Propagation::current().mark(dependent); }
+                                else if (pass == Pass::SETTLE || pass == Pass::KEEP)
+                                    {
+                                    if (pass == Pass::SETTLE)
+                                        { changes.merge(array->settled); }
+                                    Propagation::current().settled(dependent, pass == Pass::SETTLE);
+                                    }
+                                }, slots
+                    );
+                    connect(
+                            array->onDeleted, [this](const WPropertyArray<T> &deleted)
+                                {
+                                detached.assign(deleted.data(), deleted.data() + deleted.size());
+                                array = nullptr;
+                                }, slots
+                    );
+                    }
+                };
+
+            //a property, scalar expression or plain value used as the same operand for every element
+            template<class Leaf>
+            class ArrayBroadcast
+                {
+            private:
+                Leaf leaf;
+                std::optional<typename Leaf::value_type> value;
+
+            public:
+                typedef typename Leaf::value_type value_type;
+
+                explicit ArrayBroadcast(Leaf leaf)
+                        : leaf(std::move(leaf))
+                    {}
+
+                const value_type &get(std::size_t) const
+                    { return *value; }
+
+                std::size_t size() const
+                    { return std::numeric_limits<std::size_t>::max(); }
+
+                void bind()
+                    { value = leaf.get(); }
+
+                bool collect(IndexBits &)
+                    {
+                    bool all = false;
+                    leaf.visit(
+                            [&all](auto &input)
+                                { all |= input.take_changed(); }
+                    );
+                    return all;
+                    }
+
+                void attach(Node *dependent, WSlotObject *slots)
+                    {
+                    leaf.visit(
+                            [dependent, slots](auto &input)
+                                { input.attach(dependent, slots); }
+                    );
+                    }
+                };
+
+            template<class T>
+            struct is_array_operand<WPropertyArray<T> >
+                    : std::true_type
+                {};
+
+            template<class F, class... Nodes>
+            struct is_array_operand<WArrayExpr<F, Nodes...> >
+                    : std::true_type
+                {};
+
+            template<class T>
+            inline ArrayInput<T> array_node(WPropertyArray<T> &array)
+                { return ArrayInput<T>(&array); }
+
+            template<class F, class... Nodes>
+            inline WArrayExpr<F, Nodes...> array_node(const WArrayExpr<F, Nodes...> &expr)
+                { return expr; }
+
+            template<class V, class = typename std::enable_if<!is_array_operand<typename std::decay<V>::type>::value>::type>
+            inline ArrayBroadcast<decltype(expr_node(std::declval<V>()))> array_node(V &&operand)
+                { return ArrayBroadcast<decltype(expr_node(std::declval<V>()))>(expr_node(std::forward<V>(operand))); }
+
+            template<class T>
+            class ArrayBindingBase
+                {
+            public:
+                virtual ~ArrayBindingBase()
+                    {}
+
+                //assigns every element of values
+                virtual void compute(std::vector<T> &values) = 0;
+                //recomputes the elements whose inputs changed plus those already in changed, and adds them
+                virtual void recompute(std::vector<T> &values, IndexBits &changed) = 0;
+                };
+
+            //elements of an array computed from a WArrayExpr, only the ones whose inputs changed are
+            //recomputed, each run of them in one loop over contiguous memory the compiler can vectorize
+            template<class T, class Expr>
+            class ArrayBinding : public ArrayBindingBase<T>, public WSlotObject
+                {
+            private:
+                Expr expr;
+
+                void run(T *out, std::size_t begin, std::size_t end) const
+                    {
+                    for (std::size_t i = begin; i < end; i++)
+                        { out[i] = expr.get(i); }
+                    }
+
+            public:
+                ArrayBinding(Node *parent, const Expr &expr)
+                        : expr(expr)
+                    { this->expr.attach(parent, this); }
+
+                std::size_t size() const
+                    { return expr.size(); }
+
+                void compute(std::vector<T> &values)
+                    {
+                    if (expr.size() < values.size())
+                        { throw std::length_error("WPropertyArray expression shorter than the array"); }
+                    internal::trace::Span span("WPropertyArray recompute");
+                    expr.bind();
+                    run(values.data(), 0, values.size());
+                    }
+
+                void recompute(std::vector<T> &values, IndexBits &changed)
+                    {
+                    bool all = expr.collect(changed);
+                    internal::trace::Span span("WPropertyArray recompute");
+                    expr.bind();
+                    T *out = values.data();
+                    if (all)
+                        {
+                        changed.fill(values.size());
+                        run(out, 0, values.size());
+                        }
+                    else
+                        {
+                        changed.trim(values.size());
+                        changed.for_each_run(
+                                [this, out](std::size_t begin, std::size_t end)
+                                    { run(out, begin, end); }
+                        );
+                        }
+                    }
+                };
+            }
+        }
+
+    //an element wise function of arrays, scalar properties, scalar expressions and plain values, built by
+    //make_array_expr() or the arithmetic operators and assigned to a WPropertyArray. it is as long as its
+    //shortest array, scalar operands are used for every element
+    template<class F, class... Nodes>
+    class WArrayExpr
+        {
+    private:
+        F function;
+        std::tuple<Nodes...> nodes;
+
+    public:
+        typedef typename std::decay<
+                typename std::invoke_result<
+                        const F &, decltype(std::declval<const Nodes &>().get(std::size_t()))...>::type>::type value_type;
+
+        WArrayExpr(F function, Nodes... nodes)
+                : function(std::move(function)),
+                  nodes(std::move(nodes)...)
+            {}
+
+        value_type get(std::size_t index) const
+            {
+            return std::apply(
+                    [this, index](const Nodes &... node)
+                        { return function(node.get(index)...); }, nodes
+            );
+            }
+
+        std::size_t size() const
+            {
+            std::size_t size = std::numeric_limits<std::size_t>::max();
+            std::apply(
+                    [&size](const Nodes &... node)
+                        { ((size = std::min(size, node.size())), ...); }, nodes
+            );
+            return size;
+            }
+
+        void bind()
+            {
+            std::apply(
+                    [](Nodes &... node)
+                        { (node.bind(), ...); }, nodes
+            );
+            }
+
+        bool collect(internal::property::IndexBits &changed)
+            {
+            bool all = false;
+            std::apply(
+                    [&all, &changed](Nodes &... node)
+                        { ((all |= node.collect(changed)), ...); }, nodes
+            );
+            return all;
+            }
+
+        void attach(internal::property::Node *dependent, WSlotObject *slots)
+            {
+            std::apply(
+                    [dependent, slots](Nodes &... node)
+                        { (node.attach(dependent, slots), ...); }, nodes
+            );
+            }
+        };
+
+    //at least one operand has to be an array or array expression
+    template<class F, class... Operands>
+    inline WArrayExpr<typename std::decay<F>::type, decltype(internal::property::array_node(std::declval<Operands>()))...>
+    make_array_expr(F &&function, Operands &&... operands)
+        {
+        static_assert(
+                (internal::property::is_array_operand<typename std::decay<Operands>::type>::value || ...),
+                "make_array_expr needs an array operand"
+        );
+        return WArrayExpr<typename std::decay<F>::type, decltype(internal::property::array_node(std::declval<Operands>()))...>(
+                std::forward<F>(function),
+                internal::property::array_node(std::forward<Operands>(operands))...
+        );
+        }
+
+//a non type parameter so these do not redeclare the scalar operators, which step aside for arrays
+#define WEVENTS_ARRAY_OPERATOR(op, function) \
+    template<class L, class R, typename std::enable_if< \
+            internal::property::is_array_operand<typename std::decay<L>::type>::value || \
+            internal::property::is_array_operand<typename std::decay<R>::type>::value, int>::type = 0> \
+    inline auto operator op(L &&left, R &&right) \
+        { return make_array_expr(function(), std::forward<L>(left), std::forward<R>(right)); }
+
+    WEVENTS_ARRAY_OPERATOR(+, std::plus<>)
+    WEVENTS_ARRAY_OPERATOR(-, std::minus<>)
+    WEVENTS_ARRAY_OPERATOR(*, std::multiplies<>)
+    WEVENTS_ARRAY_OPERATOR(/, std::divides<>)
+    WEVENTS_ARRAY_OPERATOR(%, std::modulus<>)
+
+#undef WEVENTS_ARRAY_OPERATOR
+
+    //a fixed number of elements stored contiguously that propagate as a single node. every element costs
+    //sizeof(T) plus two bits for the elements written and the elements the last change touched, so only
+    //those are recomputed downstream and reported to onChanged. an array assigned an expression is
+    //always eager, writing one of its elements drops the expression
+    template<class T>
+    class WPropertyArray : public internal::property::Node
+        {
+    private:
+        template<class U>
+        friend class internal::property::ArrayInput;
+
+        std::vector<T> values;
+        //elements written since the last propagation
+        internal::property::IndexBits written;
+        //elements the last propagation changed, merged by dependents when this settles
+        internal::property::IndexBits settled;
+        internal::property::ArrayBindingBase<T> *binding;
+        std::vector<std::size_t> indices;
+
+        void changed()
+            { internal::property::Propagation::current().changed(this); }
+
+        void invalidate()
+            {}
+
+        bool prepare()
+            {
+            settled.clear();
+            settled.swap(written);
+            if (binding != nullptr)
+                { binding->recompute(values, settled); }
+            return settled.any();
+            }
+
+        //the indices are only listed when somebody is connected to onChanged
+        void publish()
+            {
+            onInvalidated.emit();
+            if (onChanged.has_connections())
+                {
+                indices.clear();
+                settled.for_each_run(
+                        [this](std::size_t begin, std::size_t end)
+                            {
+                            for (std::size_t i = begin; i < end; i++)
+                                { indices.push_back(i); }
+                            }
+                );
+                onChanged.emit(indices);
+                }
+            }
+
+        void keep()
+            {}
+
+        void pull()
+            {}
+
+        void detach()
+            {
+            delete binding;
+            binding = nullptr;
+            }
+
+        template<class F, class... Nodes>
+        internal::property::ArrayBindingBase<T> *bind_expr(const WArrayExpr<F, Nodes...> &expr)
+            {
+            auto *bound = new internal::property::ArrayBinding<T, WArrayExpr<F, Nodes...> >(this, expr);
+            try
+                { bound->compute(values); }
+            catch (...)
+                {
+                delete bound;
+                throw;
+                }
+            return bound;
+            }
+
+    public:
+        typedef T value_type;
+
+        explicit WPropertyArray(std::size_t size, const T &value = T())
+                : values(size, value),
+                  binding(nullptr)
+            {
+            written.resize(size);
+            settled.resize(size);
+            }
+
+        template<class F, class... Nodes>
+        WPropertyArray(const WArrayExpr<F, Nodes...> &expr)
+                : values(expr.size()),
+                  binding(nullptr)
+            {
+            written.resize(values.size());
+            settled.resize(values.size());
+            binding = bind_expr(expr);
+            }
+
+        WPropertyArray(const WPropertyArray<T> &) = delete;
+        WPropertyArray<T> &operator=(const WPropertyArray<T> &) = delete;
+
+        ~WPropertyArray()
+            {
+            onDeleted.emit(*this);
+            delete binding;
+            }
+
+        //the indices of the elements that changed, ascending
+        WLazySignal<const std::vector<std::size_t> &> onChanged;
+        WLazySignal<> onInvalidated;
+        WLazySignal<const WPropertyArray<T> &> onDeleted;
+
+        std::size_t size() const
+            { return values.size(); }
+
+        const T &get(std::size_t index) const
+            { return values[index]; }
+
+        const T *data() const
+            { return values.data(); }
+
+        void set(std::size_t index, const T &value)
+            {
+            detach();
+            values[index] = value;
+            written.set(index);
+            changed();
+            }
+
+        //func gets every element at once and they all count as changed
+        void operate(std::function<void(T *, std::size_t)> func)
+            {
+            detach();
+            func(values.data(), values.size());
+            written.fill(values.size());
+            changed();
+            }
+
+        //the expression has to be at least as long as the array
+        template<class F, class... Nodes>
+        WPropertyArray<T> &operator=(const WArrayExpr<F, Nodes...> &expr)
+            {
+            WPropertyTransaction batch;
+            internal::property::ArrayBindingBase<T> *bound = bind_expr(expr);
+            detach();
+            binding = bound;
+            written.fill(values.size());
+            changed();
+            return *this;
+            }
+        };
+    }
+
+#endif //WGUI_W_PROPERTY_ARRAY_H
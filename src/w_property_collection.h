@@ -0,0 +1,1273 @@
+//
+// Created by Administrator on 9/23/2017.
+//
+
+#ifndef WGUI_W_PROPERTY_COLLECTION_H
+#define WGUI_W_PROPERTY_COLLECTION_H
+
+#include <map>
+#include <optional>
+
+#include "w_property.h"
+
+namespace wevents
+    {
+    template<class T>
+    class WPropertyVector;
+
+    template<class K, class V, class Compare = std::less<K> >
+    class WPropertyMap;
+
+    //one step of a change to a WPropertyVector, index is where it happened after the steps before it
+    template<class T>
+    struct WVectorChange
+        {
+        enum Kind
+            {
+            INSERTED,
+            ERASED,
+            UPDATED,
+            };
+
+        Kind kind;
+        std::size_t index;
+        //the inserted elements or the new values of the updated ones
+        std::vector<T> values;
+        //the erased elements or the old values of the updated ones
+        std::vector<T> previous;
+
+        std::size_t count() const
+            { return kind == ERASED ? previous.size() : values.size(); }
+
+        template<class F>
+        void added(F &&f) const
+            {
+            for (const T &value : values)
+                { f(value); }
+            }
+
+        template<class F>
+        void removed(F &&f) const
+            {
+            for (const T &value : previous)
+                { f(value); }
+            }
+        };
+
+    //one step of a change to a WPropertyMap
+    template<class K, class V>
+    struct WMapChange
+        {
+        enum Kind
+            {
+            INSERTED,
+            ERASED,
+            UPDATED,
+            };
+
+        Kind kind;
+        K key;
+        //set unless the key was erased
+        std::optional<V> value;
+        //set unless the key was inserted
+        std::optional<V> previous;
+
+        template<class F>
+        void added(F &&f) const
+            {
+            if (value)
+                { f(*value); }
+            }
+
+        template<class F>
+        void removed(F &&f) const
+            {
+            if (previous)
+                { f(*previous); }
+            }
+        };
+
+    namespace internal
+        {
+        namespace property
+            {
+            //the edits below apply to values and describe themselves in changes, merging into the last
+            //change when they continue it so a loop of push_back()s is one INSERTED
+            template<class T, class It>
+            void vector_insert(std::vector<T> &values, std::vector<WVectorChange<T> > &changes, std::size_t index,
+                               It first, It last)
+                {
+                if (first == last)
+                    { return; }
+                values.insert(values.begin() + index, first, last);
+                if (!changes.empty() && changes.back().kind == WVectorChange<T>::INSERTED &&
+                    changes.back().index + changes.back().values.size() == index)
+                    { changes.back().values.insert(changes.back().values.end(), first, last); }
+                else
+                    { changes.push_back(WVectorChange<T>{WVectorChange<T>::INSERTED, index, std::vector<T>(first, last), {}}); }
+                }
+
+            template<class T>
+            void vector_erase(std::vector<T> &values, std::vector<WVectorChange<T> > &changes, std::size_t index,
+                              std::size_t count)
+                {
+                if (count == 0)
+                    { return; }
+                auto begin = values.begin() + index;
+                if (!changes.empty() && changes.back().kind == WVectorChange<T>::ERASED && changes.back().index == index)
+                    { changes.back().previous.insert(changes.back().previous.end(), begin, begin + count); }
+                else
+                    { changes.push_back(WVectorChange<T>{WVectorChange<T>::ERASED, index, {}, std::vector<T>(begin, begin + count)}); }
+                values.erase(begin, begin + count);
+                }
+
+            template<class T>
+            void vector_update(std::vector<T> &values, std::vector<WVectorChange<T> > &changes, std::size_t index,
+                               const T &value)
+                {
+                if (!changes.empty() && changes.back().kind == WVectorChange<T>::UPDATED &&
+                    changes.back().index + changes.back().values.size() == index)
+                    {
+                    changes.back().values.push_back(value);
+                    changes.back().previous.push_back(values[index]);
+                    }
+                else
+                    { changes.push_back(WVectorChange<T>{WVectorChange<T>::UPDATED, index, {value}, {values[index]}}); }
+                values[index] = value;
+                }
+
+            template<class K, class V, class Compare>
+            void map_set(std::map<K, V, Compare> &values, std::vector<WMapChange<K, V> > &changes, const K &key,
+                         const V &value)
+                {
+                auto found = values.find(key);
+                if (found == values.end())
+                    {
+                    values.emplace(key, value);
+                    changes.push_back(WMapChange<K, V>{WMapChange<K, V>::INSERTED, key, value, std::nullopt});
+                    }
+                else
+                    {
+                    changes.push_back(WMapChange<K, V>{WMapChange<K, V>::UPDATED, key, value, found->second});
+                    found->second = value;
+                    }
+                }
+
+            //does nothing when key is not in values
+            template<class K, class V, class Compare>
+            void map_erase(std::map<K, V, Compare> &values, std::vector<WMapChange<K, V> > &changes, const K &key)
+                {
+                auto found = values.find(key);
+                if (found == values.end())
+                    { return; }
+                changes.push_back(WMapChange<K, V>{WMapChange<K, V>::ERASED, key, std::nullopt, std::move(found->second)});
+                values.erase(found);
+                }
+
+            template<class T, class F>
+            void for_each_element(const std::vector<T> &values, F &&f)
+                {
+                for (const T &value : values)
+                    { f(value); }
+                }
+
+            template<class K, class V, class Compare, class F>
+            void for_each_element(const std::map<K, V, Compare> &values, F &&f)
+                {
+                for (const auto &entry : values)
+                    { f(entry.second); }
+                }
+
+            //the changes of a collection read by a derived one, buffered from when it settles until
+            //the dependent recomputes
+            template<class Collection>
+            class CollectionInput
+                {
+            private:
+                Collection *collection;
+                std::vector<typename Collection::change_type> incoming;
+
+            public:
+                explicit CollectionInput(Collection *collection)
+                        : collection(collection)
+                    {}
+
+                //null once the collection is deleted
+                const Collection *get() const
+                    { return collection; }
+
+                //every change since the last call, in order
+                std::vector<typename Collection::change_type> take()
+                    {
+                    std::vector<typename Collection::change_type> taken;
+                    taken.swap(incoming);
+                    return taken;
+                    }
+
+                void attach(Node *dependent, WSlotObject *slots)
+                    {
+                    connect(
+                            collection->propagation_passes(), [this, dependent](Pass pass)
+                                {
+                                if (pass == Pass::MARK)
+                                    { Propagation::current().mark(dependent); }
+                                else if (pass == Pass::SETTLE || pass == Pass::KEEP)
+                                    {
+                                    if (pass == Pass::SETTLE)
+                                        {
+                                        incoming.insert(
+                                                incoming.end(), collection->settled.begin(), collection->settled.end()
+                                        );
+                                        }
+                                    Propagation::current().settled(dependent, pass == Pass::SETTLE);
+                                    }
+                                }, slots
+                    );
+                    connect(
+                            collection->onDeleted, [this](const Collection &)
+                                { collection = nullptr; }, slots
+                    );
+                    }
+                };
+
+            //a scalar kept up to date from the changes of a collection, usable in a WExpr. the changes are
+            //folded in as the collection settles, which is before any of its dependents recompute
+            template<class Collection, class Fold>
+            class CollectionFold
+                {
+            private:
+                Collection *collection;
+                //the empty fold, every fold starts over from it
+                Fold seed;
+                //folds hold user functions, which can be copied but not assigned
+                mutable std::optional<Fold> fold;
+                //kept up to date by the collection's passes once attached
+                bool attached;
+                bool changed;
+
+                void refold() const
+                    {
+                    fold.emplace(seed);
+                    for_each_element(
+                            collection->values(), [this](const auto &element)
+                                { this->fold->add(element); }
+                    );
+                    }
+
+            public:
+                typedef typename Fold::value_type value_type;
+
+                CollectionFold(Collection *collection, Fold fold)
+                        : collection(collection),
+                          seed(std::move(fold)),
+                          attached(false),
+                          changed(false)
+                    {}
+
+                //a fold nothing is bound to yet reads the collection as it is now
+                const value_type &get() const
+                    {
+                    if (!attached && collection != nullptr)
+                        { refold(); }
+                    return fold->value();
+                    }
+
+                bool take_changed()
+                    {
+                    bool result = changed;
+                    changed = false;
+                    return result;
+                    }
+
+                template<class Visitor>
+                void visit(Visitor &&visitor)
+                    { visitor(*this); }
+
+                //folds the collection as it is when bound, changes made since the expression was created
+                //are in it already
+                void attach(Node *dependent, WSlotObject *slots)
+                    {
+                    refold();
+                    attached = true;
+                    connect(
+                            collection->propagation_passes(), [this, dependent](Pass pass)
+                                {
+                                if (pass == Pass::MARK)
+                                    { Propagation::current().mark(dependent); }
+                                else if (pass == Pass::SETTLE || pass == Pass::KEEP)
+                                    {
+                                    if (pass == Pass::SETTLE)
+                                        {
+                                        for (const auto &change : collection->settled)
+                                            {
+                                            change.removed(
+                                                    [this](const auto &element)
+                                                        { fold->remove(element); }
+                                            );
+                                            change.added(
+                                                    [this](const auto &element)
+                                                        { fold->add(element); }
+                                            );
+                                            }
+                                        changed = true;
+                                        }
+                                    Propagation::current().settled(dependent, pass == Pass::SETTLE);
+                                    }
+                                }, slots
+                    );
+                    connect(
+                            collection->onDeleted, [this](const Collection &)
+                                { collection = nullptr; }, slots
+                    );
+                    }
+                };
+
+            template<class Projection, class Element>
+            struct Sum
+                {
+                typedef typename std::decay<typename std::invoke_result<const Projection &, const Element &>::type>::type value_type;
+
+                Projection projection;
+                value_type total{};
+
+                void add(const Element &element)
+                    { total += projection(element); }
+
+                void remove(const Element &element)
+                    { total -= projection(element); }
+
+                const value_type &value() const
+                    { return total; }
+                };
+
+            template<class Predicate, class Element>
+            struct Count
+                {
+                typedef std::size_t value_type;
+
+                Predicate predicate;
+                std::size_t count = 0;
+
+                void add(const Element &element)
+                    {
+                    if (predicate(element))
+                        { count++; }
+                    }
+
+                void remove(const Element &element)
+                    {
+                    if (predicate(element))
+                        { count--; }
+                    }
+
+                const std::size_t &value() const
+                    { return count; }
+                };
+
+            struct Identity
+                {
+                template<class V>
+                const V &operator()(const V &value) const
+                    { return value; }
+                };
+
+            struct Always
+                {
+                template<class V>
+                bool operator()(const V &) const
+                    { return true; }
+                };
+
+            template<class T>
+            class VectorBindingBase
+                {
+            public:
+                virtual ~VectorBindingBase()
+                    {}
+
+                //fills values from scratch
+                virtual void compute(std::vector<T> &values) = 0;
+                //applies the input changes since the last call to values and describes them in changes
+                virtual void recompute(std::vector<T> &values, std::vector<WVectorChange<T> > &changes) = 0;
+                };
+
+            //values[i] is f(source[i])
+            template<class T, class S, class F>
+            class VectorMap : public VectorBindingBase<T>, public WSlotObject
+                {
+            private:
+                CollectionInput<WPropertyVector<S> > input;
+                F function;
+
+                std::vector<T> apply(const std::vector<S> &source) const
+                    {
+                    std::vector<T> result;
+                    result.reserve(source.size());
+                    for (const S &value : source)
+                        { result.push_back(function(value)); }
+                    return result;
+                    }
+
+            public:
+                VectorMap(Node *parent, WPropertyVector<S> *source, F function)
+                        : input(source),
+                          function(std::move(function))
+                    { input.attach(parent, this); }
+
+                void compute(std::vector<T> &values)
+                    { values = apply(input.get()->values()); }
+
+                void recompute(std::vector<T> &values, std::vector<WVectorChange<T> > &changes)
+                    {
+                    for (const WVectorChange<S> &change : input.take())
+                        {
+                        if (change.kind == WVectorChange<S>::INSERTED)
+                            {
+                            std::vector<T> inserted = apply(change.values);
+                            vector_insert(values, changes, change.index, inserted.begin(), inserted.end());
+                            }
+                        else if (change.kind == WVectorChange<S>::ERASED)
+                            { vector_erase(values, changes, change.index, change.count()); }
+                        else
+                            {
+                            for (std::size_t i = 0; i < change.values.size(); i++)
+                                { vector_update(values, changes, change.index + i, T(function(change.values[i]))); }
+                            }
+                        }
+                    }
+                };
+
+            //prefix sums over counts that change one at a time, updates and queries are O(log n)
+            class Fenwick
+                {
+            private:
+                std::vector<std::size_t> tree;
+
+            public:
+                void assign(const std::vector<std::size_t> &counts)
+                    {
+                    tree.assign(counts.size() + 1, 0);
+                    for (std::size_t i = 1; i < tree.size(); i++)
+                        {
+                        tree[i] += counts[i - 1];
+                        std::size_t parent = i + (i & (0 - i));
+                        if (parent < tree.size())
+                            { tree[parent] += tree[i]; }
+                        }
+                    }
+
+                //delta wraps around to take away
+                void add(std::size_t index, std::size_t delta)
+                    {
+                    for (std::size_t i = index + 1; i < tree.size(); i += i & (0 - i))
+                        { tree[i] += delta; }
+                    }
+
+                //the sum of the first count counts
+                std::size_t prefix(std::size_t count) const
+                    {
+                    std::size_t sum = 0;
+                    for (std::size_t i = count; i > 0; i -= i & (0 - i))
+                        { sum += tree[i]; }
+                    return sum;
+                    }
+
+                //the first index the prefix sum up to and including it goes past value at, value becomes
+                //the offset into it. the size when value is the total
+                std::size_t find(std::size_t &value) const
+                    {
+                    std::size_t step = 1;
+                    while (step * 2 < tree.size())
+                        { step *= 2; }
+                    std::size_t at = 0;
+                    for (; step > 0; step /= 2)
+                        {
+                        if (at + step < tree.size() && tree[at + step] <= value)
+                            {
+                            at += step;
+                            value -= tree[at];
+                            }
+                        }
+                    return at;
+                    }
+                };
+
+            //the elements of source passing predicate, in their order. blocks holds a flag for every
+            //element of source, split into runs of about BLOCK. sizes and counts sum up how many flags and
+            //how many set ones are in the blocks before, so finding a source index and the position of
+            //its element in values only looks at one block. an insert or erase only changes the blocks
+            //it lands in, one that grows past twice BLOCK is split up again
+            template<class T, class Predicate>
+            class VectorFilter : public VectorBindingBase<T>, public WSlotObject
+                {
+            private:
+                static constexpr std::size_t BLOCK = 1024;
+
+                CollectionInput<WPropertyVector<T> > input;
+                Predicate predicate;
+                std::vector<std::vector<unsigned char> > blocks;
+                Fenwick sizes;
+                Fenwick counts;
+                std::size_t total = 0;
+
+                static std::size_t set_in(const std::vector<unsigned char> &flags, std::size_t first, std::size_t last)
+                    { return std::size_t(std::count(flags.begin() + first, flags.begin() + last, 1)); }
+
+                //splits the flags back up into blocks of BLOCK
+                void rebuild(const std::vector<unsigned char> &flags)
+                    {
+                    blocks.clear();
+                    for (std::size_t i = 0; i < flags.size() || blocks.empty(); i += BLOCK)
+                        {
+                        auto begin = flags.begin() + i;
+                        blocks.emplace_back(begin, begin + std::min(BLOCK, flags.size() - i));
+                        }
+                    total = flags.size();
+                    reindex();
+                    }
+
+                void reindex()
+                    {
+                    std::vector<std::size_t> block_sizes;
+                    std::vector<std::size_t> block_counts;
+                    for (const std::vector<unsigned char> &block : blocks)
+                        {
+                        block_sizes.push_back(block.size());
+                        block_counts.push_back(set_in(block, 0, block.size()));
+                        }
+                    sizes.assign(block_sizes);
+                    counts.assign(block_counts);
+                    }
+
+                std::vector<unsigned char> flatten() const
+                    {
+                    std::vector<unsigned char> flags;
+                    flags.reserve(total);
+                    for (const std::vector<unsigned char> &block : blocks)
+                        { flags.insert(flags.end(), block.begin(), block.end()); }
+                    return flags;
+                    }
+
+                //the block source index is in and the offset into it, the end of the last block for the size
+                std::size_t locate(std::size_t &offset) const
+                    {
+                    std::size_t block = sizes.find(offset);
+                    if (block == blocks.size())
+                        {
+                        block--;
+                        offset = blocks[block].size();
+                        }
+                    return block;
+                    }
+
+                std::size_t position(std::size_t block, std::size_t offset) const
+                    { return counts.prefix(block) + set_in(blocks[block], 0, offset); }
+
+            public:
+                VectorFilter(Node *parent, WPropertyVector<T> *source, Predicate predicate)
+                        : input(source),
+                          predicate(std::move(predicate))
+                    { input.attach(parent, this); }
+
+                void compute(std::vector<T> &values)
+                    {
+                    values.clear();
+                    std::vector<unsigned char> flags;
+                    for (const T &value : input.get()->values())
+                        {
+                        bool keep = predicate(value);
+                        flags.push_back(keep);
+                        if (keep)
+                            { values.push_back(value); }
+                        }
+                    rebuild(flags);
+                    }
+
+                void recompute(std::vector<T> &values, std::vector<WVectorChange<T> > &changes)
+                    {
+                    for (const WVectorChange<T> &change : input.take())
+                        {
+                        std::size_t offset = change.index;
+                        std::size_t block = locate(offset);
+                        std::size_t at = position(block, offset);
+                        if (change.kind == WVectorChange<T>::INSERTED)
+                            {
+                            std::vector<unsigned char> flags;
+                            std::vector<T> passing;
+                            for (const T &value : change.values)
+                                {
+                                flags.push_back(predicate(value));
+                                if (flags.back())
+                                    { passing.push_back(value); }
+                                }
+                            std::vector<unsigned char> &target = blocks[block];
+                            target.insert(target.begin() + offset, flags.begin(), flags.end());
+                            sizes.add(block, flags.size());
+                            counts.add(block, passing.size());
+                            total += flags.size();
+                            if (target.size() > 2 * BLOCK)
+                                { rebuild(flatten()); }
+                            vector_insert(values, changes, at, passing.begin(), passing.end());
+                            }
+                        else if (change.kind == WVectorChange<T>::ERASED)
+                            {
+                            std::size_t remaining = change.count();
+                            std::size_t passing = 0;
+                            while (remaining > 0)
+                                {
+                                std::vector<unsigned char> &target = blocks[block];
+                                std::size_t taken = std::min(remaining, target.size() - offset);
+                                std::size_t set = set_in(target, offset, offset + taken);
+                                target.erase(target.begin() + offset, target.begin() + offset + taken);
+                                sizes.add(block, 0 - taken);
+                                counts.add(block, 0 - set);
+                                passing += set;
+                                remaining -= taken;
+                                block++;
+                                offset = 0;
+                                }
+                            total -= change.count();
+                            //emptied blocks stay until there are about twice as many as needed
+                            if (blocks.size() > 4 + 2 * total / BLOCK)
+                                { rebuild(flatten()); }
+                            vector_erase(values, changes, at, passing);
+                            }
+                        else
+                            {
+                            for (std::size_t i = 0; i < change.values.size(); i++, offset++)
+                                {
+                                while (offset == blocks[block].size())
+                                    {
+                                    block++;
+                                    offset = 0;
+                                    }
+                                const T &value = change.values[i];
+                                unsigned char &flag = blocks[block][offset];
+                                bool keep = predicate(value);
+                                if (flag && keep)
+                                    { vector_update(values, changes, at, value); }
+                                else if (flag)
+                                    { vector_erase(values, changes, at, 1); }
+                                else if (keep)
+                                    { vector_insert(values, changes, at, &value, &value + 1); }
+                                counts.add(block, std::size_t(keep) - flag);
+                                flag = keep;
+                                if (keep)
+                                    { at++; }
+                                }
+                            }
+                        }
+                    }
+                };
+
+            //the elements of source ordered by less. an erased or updated element is found among the ones
+            //less considers equal to it with ==, an updated one that keeps its place is updated in place.
+            //source is a vector or a map, whose values are sorted
+            template<class T, class Less, class Source = WPropertyVector<T> >
+            class VectorSort : public VectorBindingBase<T>, public WSlotObject
+                {
+            private:
+                CollectionInput<Source> input;
+                Less less;
+
+                std::size_t find(const std::vector<T> &values, const T &value) const
+                    {
+                    auto range = std::equal_range(values.begin(), values.end(), value, less);
+                    return std::size_t(std::find(range.first, range.second, value) - values.begin());
+                    }
+
+                void insert(std::vector<T> &values, std::vector<WVectorChange<T> > &changes, const T &value) const
+                    {
+                    std::size_t at = std::size_t(std::upper_bound(values.begin(), values.end(), value, less) - values.begin());
+                    vector_insert(values, changes, at, &value, &value + 1);
+                    }
+
+                void update(std::vector<T> &values, std::vector<WVectorChange<T> > &changes, const T &previous,
+                            const T &value) const
+                    {
+                    std::size_t at = find(values, previous);
+                    if ((at == 0 || !less(value, values[at - 1])) &&
+                        (at + 1 >= values.size() || !less(values[at + 1], value)))
+                        { vector_update(values, changes, at, value); }
+                    else
+                        {
+                        vector_erase(values, changes, at, 1);
+                        insert(values, changes, value);
+                        }
+                    }
+
+                void apply(std::vector<T> &values, std::vector<WVectorChange<T> > &changes,
+                           const WVectorChange<T> &change) const
+                    {
+                    if (change.kind == WVectorChange<T>::UPDATED)
+                        {
+                        for (std::size_t i = 0; i < change.values.size(); i++)
+                            { update(values, changes, change.previous[i], change.values[i]); }
+                        return;
+                        }
+                    remove_add(values, changes, change);
+                    }
+
+                template<class K>
+                void apply(std::vector<T> &values, std::vector<WVectorChange<T> > &changes,
+                           const WMapChange<K, T> &change) const
+                    {
+                    if (change.kind == WMapChange<K, T>::UPDATED)
+                        {
+                        update(values, changes, *change.previous, *change.value);
+                        return;
+                        }
+                    remove_add(values, changes, change);
+                    }
+
+                template<class Change>
+                void remove_add(std::vector<T> &values, std::vector<WVectorChange<T> > &changes,
+                                const Change &change) const
+                    {
+                    change.removed(
+                            [&](const T &old)
+                                { vector_erase(values, changes, find(values, old), 1); }
+                    );
+                    change.added(
+                            [&](const T &value)
+                                { insert(values, changes, value); }
+                    );
+                    }
+
+            public:
+                VectorSort(Node *parent, Source *source, Less less)
+                        : input(source),
+                          less(std::move(less))
+                    { input.attach(parent, this); }
+
+                void compute(std::vector<T> &values)
+                    {
+                    values.clear();
+                    for_each_element(
+                            input.get()->values(), [&values](const T &value)
+                                { values.push_back(value); }
+                    );
+                    std::stable_sort(values.begin(), values.end(), less);
+                    }
+
+                void recompute(std::vector<T> &values, std::vector<WVectorChange<T> > &changes)
+                    {
+                    for (const auto &change : input.take())
+                        { apply(values, changes, change); }
+                    }
+                };
+
+            template<class K, class V, class Compare>
+            class MapBindingBase
+                {
+            public:
+                virtual ~MapBindingBase()
+                    {}
+
+                virtual void compute(std::map<K, V, Compare> &values) = 0;
+                virtual void recompute(std::map<K, V, Compare> &values, std::vector<WMapChange<K, V> > &changes) = 0;
+                };
+
+            //the entries of source whose value passes predicate
+            template<class K, class V, class Compare, class Predicate>
+            class MapFilter : public MapBindingBase<K, V, Compare>, public WSlotObject
+                {
+            private:
+                CollectionInput<WPropertyMap<K, V, Compare> > input;
+                Predicate predicate;
+
+            public:
+                MapFilter(Node *parent, WPropertyMap<K, V, Compare> *source, Predicate predicate)
+                        : input(source),
+                          predicate(std::move(predicate))
+                    { input.attach(parent, this); }
+
+                void compute(std::map<K, V, Compare> &values)
+                    {
+                    values.clear();
+                    for (const auto &entry : input.get()->values())
+                        {
+                        if (predicate(entry.second))
+                            { values.emplace_hint(values.end(), entry); }
+                        }
+                    }
+
+                //a value that stops passing erases its key, one that starts passing inserts it
+                void recompute(std::map<K, V, Compare> &values, std::vector<WMapChange<K, V> > &changes)
+                    {
+                    for (const WMapChange<K, V> &change : input.take())
+                        {
+                        if (change.value && predicate(*change.value))
+                            { map_set(values, changes, change.key, *change.value); }
+                        else
+                            { map_erase(values, changes, change.key); }
+                        }
+                    }
+                };
+
+            //values[key] is f(source[key])
+            template<class K, class V, class Compare, class S, class F>
+            class MapMap : public MapBindingBase<K, V, Compare>, public WSlotObject
+                {
+            private:
+                CollectionInput<WPropertyMap<K, S, Compare> > input;
+                F function;
+
+            public:
+                MapMap(Node *parent, WPropertyMap<K, S, Compare> *source, F function)
+                        : input(source),
+                          function(std::move(function))
+                    { input.attach(parent, this); }
+
+                void compute(std::map<K, V, Compare> &values)
+                    {
+                    values.clear();
+                    for (const auto &entry : input.get()->values())
+                        { values.emplace_hint(values.end(), entry.first, function(entry.second)); }
+                    }
+
+                void recompute(std::map<K, V, Compare> &values, std::vector<WMapChange<K, V> > &changes)
+                    {
+                    for (const WMapChange<K, S> &change : input.take())
+                        {
+                        if (change.value)
+                            { map_set(values, changes, change.key, V(function(*change.value))); }
+                        else
+                            { map_erase(values, changes, change.key); }
+                        }
+                    }
+                };
+            }
+        }
+
+    //a derived vector made by filtered(), mapped() or sorted(), assigned to a WPropertyVector
+    template<class T, class Binding, class Source, class F>
+    class WVectorOperator
+        {
+    private:
+        template<class U>
+        friend class WPropertyVector;
+
+        Source *source;
+        F function;
+
+        internal::property::VectorBindingBase<T> *bind(internal::property::Node *parent) const
+            { return new Binding(parent, source, function); }
+
+    public:
+        WVectorOperator(Source *source, F function)
+                : source(source),
+                  function(std::move(function))
+            {}
+        };
+
+    //a derived map made by filtered() or mapped(), assigned to a WPropertyMap
+    template<class K, class V, class Compare, class Binding, class Source, class F>
+    class WMapOperator
+        {
+    private:
+        template<class K2, class V2, class C2>
+        friend class WPropertyMap;
+
+        Source *source;
+        F function;
+
+        internal::property::MapBindingBase<K, V, Compare> *bind(internal::property::Node *parent) const
+            { return new Binding(parent, source, function); }
+
+    public:
+        WMapOperator(Source *source, F function)
+                : source(source),
+                  function(std::move(function))
+            {}
+        };
+
+    //a vector property whose subscribers and dependents get what changed instead of the whole vector.
+    //filtered(), mapped(), sorted(), summed() and counted() keep derived values up to date by applying
+    //those changes, so their cost follows the size of a change rather than of the vector. writing to a
+    //derived vector drops what it was derived from
+    template<class T>
+    class WPropertyVector : public internal::property::Node
+        {
+    private:
+        template<class C>
+        friend class internal::property::CollectionInput;
+
+        template<class C, class F>
+        friend class internal::property::CollectionFold;
+
+        std::vector<T> elements;
+        //changes made since the last propagation
+        std::vector<WVectorChange<T> > pending;
+        //changes of the last propagation, read by dependents when this settles
+        std::vector<WVectorChange<T> > settled;
+        internal::property::VectorBindingBase<T> *binding;
+
+        void changed()
+            { internal::property::Propagation::current().changed(this); }
+
+        void invalidate()
+            {}
+
+        bool prepare()
+            {
+            settled.clear();
+            settled.swap(pending);
+            if (binding != nullptr)
+                {
+                internal::trace::Span span("WPropertyVector recompute");
+                binding->recompute(elements, settled);
+                }
+            return !settled.empty();
+            }
+
+        void publish()
+            {
+            onInvalidated.emit();
+            onChanged.emit(settled);
+            }
+
+        void keep()
+            {}
+
+        void pull()
+            {}
+
+        void detach()
+            {
+            delete binding;
+            binding = nullptr;
+            }
+
+        template<class Binding, class Source, class F>
+        internal::property::VectorBindingBase<T> *bind_operator(
+                const WVectorOperator<T, Binding, Source, F> &op, std::vector<T> &values)
+            {
+            internal::property::VectorBindingBase<T> *bound = op.bind(this);
+            try
+                { bound->compute(values); }
+            catch (...)
+                {
+                delete bound;
+                throw;
+                }
+            return bound;
+            }
+
+    public:
+        typedef T value_type;
+        typedef WVectorChange<T> change_type;
+
+        WPropertyVector()
+                : binding(nullptr)
+            {}
+
+        WPropertyVector(std::vector<T> values)
+                : elements(std::move(values)),
+                  binding(nullptr)
+            {}
+
+        template<class Binding, class Source, class F>
+        WPropertyVector(const WVectorOperator<T, Binding, Source, F> &op)
+                : binding(nullptr)
+            { binding = bind_operator(op, elements); }
+
+        WPropertyVector(const WPropertyVector<T> &) = delete;
+        WPropertyVector<T> &operator=(const WPropertyVector<T> &) = delete;
+
+        ~WPropertyVector()
+            {
+            onDeleted.emit(*this);
+            delete binding;
+            }
+
+        //everything that changed during one propagation, in the order it happened
+        WLazySignal<const std::vector<WVectorChange<T> > &> onChanged;
+        WLazySignal<> onInvalidated;
+        WLazySignal<const WPropertyVector<T> &> onDeleted;
+
+        std::size_t size() const
+            { return elements.size(); }
+
+        const T &get(std::size_t index) const
+            { return elements[index]; }
+
+        const std::vector<T> &values() const
+            { return elements; }
+
+        void insert(std::size_t index, const T &value)
+            {
+            detach();
+            internal::property::vector_insert(elements, pending, index, &value, &value + 1);
+            changed();
+            }
+
+        template<class It>
+        void insert(std::size_t index, It first, It last)
+            {
+            detach();
+            internal::property::vector_insert(elements, pending, index, first, last);
+            changed();
+            }
+
+        void push_back(const T &value)
+            { insert(elements.size(), value); }
+
+        void erase(std::size_t index, std::size_t count = 1)
+            {
+            detach();
+            internal::property::vector_erase(elements, pending, index, count);
+            changed();
+            }
+
+        void set(std::size_t index, const T &value)
+            {
+            detach();
+            internal::property::vector_update(elements, pending, index, value);
+            changed();
+            }
+
+        void clear()
+            { erase(0, elements.size()); }
+
+        //the old elements are erased and the operator's inserted
+        template<class Binding, class Source, class F>
+        WPropertyVector<T> &operator=(const WVectorOperator<T, Binding, Source, F> &op)
+            {
+            WPropertyTransaction batch;
+            std::vector<T> values;
+            internal::property::VectorBindingBase<T> *bound = bind_operator(op, values);
+            detach();
+            binding = bound;
+            internal::property::vector_erase(elements, pending, 0, elements.size());
+            internal::property::vector_insert(elements, pending, 0, values.begin(), values.end());
+            changed();
+            return *this;
+            }
+        };
+
+    //a map property whose subscribers and dependents get the keys that changed instead of the whole map.
+    //filtered() and mapped() derive maps from it and sorted() a vector of its values, all kept up to date
+    //from those changes. writing to a derived map drops what it was derived from
+    template<class K, class V, class Compare>
+    class WPropertyMap : public internal::property::Node
+        {
+    private:
+        template<class C>
+        friend class internal::property::CollectionInput;
+
+        template<class C, class F>
+        friend class internal::property::CollectionFold;
+
+        std::map<K, V, Compare> entries;
+        std::vector<WMapChange<K, V> > pending;
+        std::vector<WMapChange<K, V> > settled;
+        internal::property::MapBindingBase<K, V, Compare> *binding;
+
+        void changed()
+            { internal::property::Propagation::current().changed(this); }
+
+        void invalidate()
+            {}
+
+        bool prepare()
+            {
+            settled.clear();
+            settled.swap(pending);
+            if (binding != nullptr)
+                {
+                internal::trace::Span span("WPropertyMap recompute");
+                binding->recompute(entries, settled);
+                }
+            return !settled.empty();
+            }
+
+        void publish()
+            {
+            onInvalidated.emit();
+            onChanged.emit(settled);
+            }
+
+        void keep()
+            {}
+
+        void pull()
+            {}
+
+        void detach()
+            {
+            delete binding;
+            binding = nullptr;
+            }
+
+        template<class Binding, class Source, class F>
+        internal::property::MapBindingBase<K, V, Compare> *bind_operator(
+                const WMapOperator<K, V, Compare, Binding, Source, F> &op, std::map<K, V, Compare> &values)
+            {
+            internal::property::MapBindingBase<K, V, Compare> *bound = op.bind(this);
+            try
+                { bound->compute(values); }
+            catch (...)
+                {
+                delete bound;
+                throw;
+                }
+            return bound;
+            }
+
+    public:
+        typedef K key_type;
+        //what summed() and counted() see of every entry
+        typedef V value_type;
+        typedef WMapChange<K, V> change_type;
+
+        WPropertyMap()
+                : binding(nullptr)
+            {}
+
+        template<class Binding, class Source, class F>
+        WPropertyMap(const WMapOperator<K, V, Compare, Binding, Source, F> &op)
+                : binding(nullptr)
+            { binding = bind_operator(op, entries); }
+
+        WPropertyMap(const WPropertyMap<K, V, Compare> &) = delete;
+        WPropertyMap<K, V, Compare> &operator=(const WPropertyMap<K, V, Compare> &) = delete;
+
+        ~WPropertyMap()
+            {
+            onDeleted.emit(*this);
+            delete binding;
+            }
+
+        //everything that changed during one propagation, in the order it happened
+        WLazySignal<const std::vector<WMapChange<K, V> > &> onChanged;
+        WLazySignal<> onInvalidated;
+        WLazySignal<const WPropertyMap<K, V, Compare> &> onDeleted;
+
+        std::size_t size() const
+            { return entries.size(); }
+
+        //null when key is not in the map
+        const V *get(const K &key) const
+            {
+            auto found = entries.find(key);
+            return found != entries.end() ? &found->second : nullptr;
+            }
+
+        bool contains(const K &key) const
+            { return entries.find(key) != entries.end(); }
+
+        const std::map<K, V, Compare> &values() const
+            { return entries; }
+
+        void set(const K &key, const V &value)
+            {
+            detach();
+            internal::property::map_set(entries, pending, key, value);
+            changed();
+            }
+
+        void erase(const K &key)
+            {
+            if (!contains(key))
+                { return; }
+            detach();
+            internal::property::map_erase(entries, pending, key);
+            changed();
+            }
+
+        //the old entries are erased and the operator's inserted
+        template<class Binding, class Source, class F>
+        WPropertyMap<K, V, Compare> &operator=(const WMapOperator<K, V, Compare, Binding, Source, F> &op)
+            {
+            WPropertyTransaction batch;
+            std::map<K, V, Compare> values;
+            internal::property::MapBindingBase<K, V, Compare> *bound = bind_operator(op, values);
+            detach();
+            binding = bound;
+            while (!entries.empty())
+                { internal::property::map_erase(entries, pending, entries.begin()->first); }
+            for (const auto &entry : values)
+                { internal::property::map_set(entries, pending, entry.first, entry.second); }
+            changed();
+            return *this;
+            }
+        };
+
+    //the elements of source passing predicate
+    template<class T, class Predicate>
+    inline WVectorOperator<T, internal::property::VectorFilter<T, Predicate>, WPropertyVector<T>, Predicate>
+    filtered(WPropertyVector<T> &source, Predicate predicate)
+        {
+        return WVectorOperator<T, internal::property::VectorFilter<T, Predicate>, WPropertyVector<T>, Predicate>(
+                &source, std::move(predicate)
+        );
+        }
+
+    //function applied to every element of source
+    template<class S, class F, class T = typename std::decay<typename std::invoke_result<const F &, const S &>::type>::type>
+    inline WVectorOperator<T, internal::property::VectorMap<T, S, F>, WPropertyVector<S>, F>
+    mapped(WPropertyVector<S> &source, F function)
+        { return WVectorOperator<T, internal::property::VectorMap<T, S, F>, WPropertyVector<S>, F>(&source, std::move(function)); }
+
+    //the elements of source ordered by less, which need == to be told apart from the ones less considers equal
+    template<class T, class Less = std::less<T> >
+    inline WVectorOperator<T, internal::property::VectorSort<T, Less>, WPropertyVector<T>, Less>
+    sorted(WPropertyVector<T> &source, Less less = Less())
+        { return WVectorOperator<T, internal::property::VectorSort<T, Less>, WPropertyVector<T>, Less>(&source, std::move(less)); }
+
+    //the entries of source whose value passes predicate
+    template<class K, class V, class Compare, class Predicate>
+    inline WMapOperator<K, V, Compare, internal::property::MapFilter<K, V, Compare, Predicate>,
+                        WPropertyMap<K, V, Compare>, Predicate>
+    filtered(WPropertyMap<K, V, Compare> &source, Predicate predicate)
+        {
+        return WMapOperator<K, V, Compare, internal::property::MapFilter<K, V, Compare, Predicate>,
+                            WPropertyMap<K, V, Compare>, Predicate>(&source, std::move(predicate));
+        }
+
+    //function applied to the value of every entry of source
+    template<class K, class S, class Compare, class F,
+             class V = typename std::decay<typename std::invoke_result<const F &, const S &>::type>::type>
+    inline WMapOperator<K, V, Compare, internal::property::MapMap<K, V, Compare, S, F>, WPropertyMap<K, S, Compare>, F>
+    mapped(WPropertyMap<K, S, Compare> &source, F function)
+        {
+        return WMapOperator<K, V, Compare, internal::property::MapMap<K, V, Compare, S, F>,
+                            WPropertyMap<K, S, Compare>, F>(&source, std::move(function));
+        }
+
+    //the values of source ordered by less, as a vector
+    template<class K, class V, class Compare, class Less = std::less<V> >
+    inline WVectorOperator<V, internal::property::VectorSort<V, Less, WPropertyMap<K, V, Compare> >,
+                           WPropertyMap<K, V, Compare>, Less>
+    sorted(WPropertyMap<K, V, Compare> &source, Less less = Less())
+        {
+        return WVectorOperator<V, internal::property::VectorSort<V, Less, WPropertyMap<K, V, Compare> >,
+                               WPropertyMap<K, V, Compare>, Less>(&source, std::move(less));
+        }
+
+    //the sum of projection over the elements of a vector or the values of a map, as an expression that
+    //can be assigned to a WProperty or used in a bigger one
+    template<class Collection, class Projection = internal::property::Identity>
+    inline auto summed(Collection &source, Projection projection = Projection())
+        {
+        typedef internal::property::Sum<Projection, typename Collection::value_type> Fold;
+        typedef internal::property::CollectionFold<Collection, Fold> Leaf;
+        return WExpr<internal::property::Identity, Leaf>(
+                internal::property::Identity(), Leaf(&source, Fold{std::move(projection)})
+        );
+        }
+
+    //how many elements of a vector or values of a map pass predicate, as an expression
+    template<class Collection, class Predicate = internal::property::Always>
+    inline auto counted(Collection &source, Predicate predicate = Predicate())
+        {
+        typedef internal::property::Count<Predicate, typename Collection::value_type> Fold;
+        typedef internal::property::CollectionFold<Collection, Fold> Leaf;
+        return WExpr<internal::property::Identity, Leaf>(
+                internal::property::Identity(), Leaf(&source, Fold{std::move(predicate)})
+        );
+        }
+    }
+
+#endif //WGUI_W_PROPERTY_COLLECTION_H
@@ -0,0 +1,202 @@
+#ifndef WEVENTS_W_PROPERTY_VERSIONS_H
+#define WEVENTS_W_PROPERTY_VERSIONS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "w_epoch.h"
+#include "w_persistent.h"
+#include "w_property.h"
+
+namespace wevents
+    {
+    class WPropertyVersions;
+
+    class WPropertySnapshot;
+
+    //where a tracked property's value is found in every snapshot
+    template<class T>
+    class WVersionSlot
+        {
+    private:
+        friend class WPropertyVersions;
+
+        friend class WPropertySnapshot;
+
+        std::size_t index;
+
+        explicit WVersionSlot(std::size_t index)
+                : index(index)
+            {}
+        };
+
+    namespace internal
+        {
+        namespace property
+            {
+            //the values of every tracked property as they were when one change finished settling. slots
+            //that did not change share their values with the version before
+            struct Version : persistent::Counted
+                {
+                std::uint64_t number;
+                WPersistentVector<std::shared_ptr<const void> > values;
+
+                Version(std::uint64_t number, WPersistentVector<std::shared_ptr<const void> > values)
+                        : number(number),
+                          values(std::move(values))
+                    {}
+                };
+
+            class VersionSlotBase
+                {
+            public:
+                virtual ~VersionSlotBase()
+                    {}
+
+                //the property settled with a change since the last call
+                virtual bool take_changed() = 0;
+                //a copy of the current value, readers only ever see it as const
+                virtual std::shared_ptr<const void> read() const = 0;
+                };
+
+            //the input keeps the last value once the property is deleted
+            template<class Property>
+            class VersionSlot : public VersionSlotBase
+                {
+            private:
+                ExprInput<Property> input;
+
+            public:
+                explicit VersionSlot(Property *property)
+                        : input(property)
+                    {}
+
+                void attach(Node *dependent, WSlotObject *slots)
+                    { input.attach(dependent, slots); }
+
+                bool take_changed()
+                    { return input.take_changed(); }
+
+                std::shared_ptr<const void> read() const
+                    { return std::make_shared<const typename Property::value_type>(input.get()); }
+                };
+            }
+        }
+
+    //one version of every property tracked by a WPropertyVersions. it keeps that version alive and can be
+    //read from and handed to any thread
+    class WPropertySnapshot
+        {
+    private:
+        friend class WPropertyVersions;
+
+        internal::persistent::Ref<internal::property::Version> version;
+
+        explicit WPropertySnapshot(internal::persistent::Ref<internal::property::Version> version)
+                : version(std::move(version))
+            {}
+
+    public:
+        //counts up from 0 with every version published
+        std::uint64_t number() const
+            { return version->number; }
+
+        template<class T>
+        const T &get(const WVersionSlot<T> &slot) const
+            { return *static_cast<const T *>(version->values[slot.index].get()); }
+        };
+
+    //versioned copies of a set of properties for readers on other threads. WProperty::get() may only be
+    //called on the thread writing the property, which settles every change through the whole graph
+    //before anything else can see it. once a change has settled through all the tracked properties a new
+    //version is published with a single atomic store, so snapshot() gives readers a consistent view of
+    //all of them with a single atomic load. versions no snapshot holds anymore are reclaimed through
+    //internal::epoch on the next publish, so besides the ones snapshots hold the writer keeps at most
+    //the version before the latest while no reader is stuck inside snapshot(). values are copied only
+    //when their property changed, so large ones should be persistent types like WPersistentMap
+    class WPropertyVersions : public internal::property::Node, public WSlotObject
+        {
+    private:
+        typedef internal::persistent::Ref<internal::property::Version> VersionRef;
+
+        std::vector<std::unique_ptr<internal::property::VersionSlotBase> > slots;
+        std::atomic<internal::property::Version *> current;
+        //the reference behind current, handed to internal::epoch once current moves on
+        VersionRef latest;
+
+        //a reader may have loaded current just before it moved on and not have counted its reference yet.
+        //collecting right away keeps a writer that publishes rarely from holding on to old versions
+        //until 32 other objects were retired on its thread
+        static void retire(VersionRef &&version)
+            {
+            internal::epoch::retire(new VersionRef(std::move(version)));
+            internal::epoch::collect();
+            }
+
+        void publish_version()
+            {
+            WPersistentVector<std::shared_ptr<const void> > values = latest->values;
+            for (std::size_t i = 0; i < slots.size(); i++)
+                {
+                if (i >= values.size())
+                    { values.push_back(slots[i]->read()); }
+                else if (slots[i]->take_changed())
+                    { values.set(i, slots[i]->read()); }
+                }
+
+            VersionRef next(new internal::property::Version(latest->number + 1, std::move(values)));
+            current.store(next.get(), std::memory_order_release);
+            retire(std::move(latest));
+            latest = std::move(next);
+            }
+
+        void invalidate()
+            {}
+
+        bool prepare()
+            { return true; }
+
+        //settled after every tracked property that changed, and on the writing thread
+        void publish()
+            { publish_version(); }
+
+        void keep()
+            {}
+
+        void pull()
+            {}
+
+    public:
+        WPropertyVersions()
+                : latest(new internal::property::Version(0, WPersistentVector<std::shared_ptr<const void> >()))
+            { current.store(latest.get(), std::memory_order_release); }
+
+        WPropertyVersions(const WPropertyVersions &) = delete;
+        WPropertyVersions &operator=(const WPropertyVersions &) = delete;
+
+        ~WPropertyVersions()
+            { retire(std::move(latest)); }
+
+        //publishes a version including property's current value right away. has to be called on the
+        //thread writing property
+        template<class T, class Change>
+        WVersionSlot<T> track(WProperty<T, Change> &property)
+            {
+            auto *slot = new internal::property::VersionSlot<WProperty<T, Change> >(&property);
+            slots.emplace_back(slot);
+            slot->attach(this, this);
+            publish_version();
+            return WVersionSlot<T>(slots.size() - 1);
+            }
+
+        //the latest version, from any thread
+        WPropertySnapshot snapshot() const
+            {
+            internal::epoch::Guard guard;
+            return WPropertySnapshot(VersionRef(current.load(std::memory_order_acquire)));
+            }
+        };
+    }
+
+#endif //WEVENTS_W_PROPERTY_VERSIONS_H
@@ -0,0 +1,336 @@
+#ifndef WEVENTS_W_TRACE_H
+#define WEVENTS_W_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "w_instrument.h"
+
+namespace wevents
+    {
+    namespace internal
+        {
+        //emit, slot, async hand off and property recompute events behind WEVENTS_TRACING. every
+        //thread writes into a ring buffer of its own, once it is full the oldest events are overwritten
+        namespace trace
+            {
+#ifdef WEVENTS_TRACING
+#ifndef WEVENTS_TRACE_BUFFER_EVENTS
+#define WEVENTS_TRACE_BUFFER_EVENTS (1 << 15)
+#endif
+            const std::size_t BUFFER_EVENTS = WEVENTS_TRACE_BUFFER_EVENTS;
+
+            enum Phase
+                {
+                BEGIN = 'B',
+                END = 'E',
+                FLOW_START = 's',
+                FLOW_END = 'f',
+                };
+
+            //fields are atomics so a flush can read a buffer while its thread keeps writing, a torn
+            //event is recognised afterwards by its position having been written over
+            struct Event
+                {
+                std::atomic<const char *> name;
+                std::atomic<std::uint64_t> ticks;
+                std::atomic<std::uint64_t> id;
+                std::atomic<char> phase;
+                };
+
+            class Buffer
+                {
+            private:
+                Event events[BUFFER_EVENTS];
+                std::atomic<std::uint64_t> head;
+
+            public:
+                const std::uint32_t thread;
+
+                explicit Buffer(std::uint32_t thread)
+                        : head(0),
+                          thread(thread)
+                    {}
+
+                //only ever called by the owning thread
+                void write(char phase, const char *name, std::uint64_t id)
+                    {
+                    std::uint64_t position = head.load(std::memory_order_relaxed);
+                    Event &event = events[position % BUFFER_EVENTS];
+                    event.name.store(name, std::memory_order_relaxed);
+                    event.ticks.store(instrument::ticks(), std::memory_order_relaxed);
+                    event.id.store(id, std::memory_order_relaxed);
+                    event.phase.store(phase, std::memory_order_relaxed);
+                    head.store(position + 1, std::memory_order_release);
+                    }
+
+                template<class F>
+                void read(F &&function) const
+                    {
+                    std::uint64_t end = head.load(std::memory_order_acquire);
+                    std::uint64_t begin = end > BUFFER_EVENTS ? end - BUFFER_EVENTS : 0;
+                    std::vector<std::uint64_t> copy_ticks;
+                    std::vector<std::uint64_t> copy_ids;
+                    std::vector<const char *> copy_names;
+                    std::vector<char> copy_phases;
+                    for (std::uint64_t i = begin; i < end; i++)
+                        {
+                        const Event &event = events[i % BUFFER_EVENTS];
+                        copy_names.push_back(event.name.load(std::memory_order_relaxed));
+                        copy_ticks.push_back(event.ticks.load(std::memory_order_relaxed));
+                        copy_ids.push_back(event.id.load(std::memory_order_relaxed));
+                        copy_phases.push_back(event.phase.load(std::memory_order_relaxed));
+                        }
+                    std::atomic_thread_fence(std::memory_order_acquire);
+
+                    //anything the writer lapped while it was being copied is dropped, including the slot of
+                    //event now which it may be halfway through overwriting
+                    std::uint64_t now = head.load(std::memory_order_relaxed);
+                    std::uint64_t valid = now + 1 > BUFFER_EVENTS ? now + 1 - BUFFER_EVENTS : 0;
+                    for (std::uint64_t i = begin; i < end; i++)
+                        {
+                        if (i < valid)
+                            { continue; }
+                        std::size_t at = std::size_t(i - begin);
+                        function(copy_phases[at], copy_names[at], copy_ticks[at], copy_ids[at]);
+                        }
+                    }
+
+                void clear()
+                    { head.store(0, std::memory_order_release); }
+                };
+
+            //buffers stay around after their thread exits so its events can still be written out
+            class Tracer
+                {
+            private:
+                std::mutex mutex;
+                std::vector<Buffer *> buffers;
+                std::unordered_set<std::string> names;
+
+            public:
+                std::atomic<bool> enabled;
+                std::atomic<std::uint64_t> next_flow;
+
+                Tracer()
+                        : enabled(false),
+                          next_flow(1)
+                    { instrument::clock(); }
+
+                Buffer *create_buffer()
+                    {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    buffers.push_back(new Buffer(std::uint32_t(buffers.size() + 1)));
+                    return buffers.back();
+                    }
+
+                //names handed to events have to outlive the signal they came from
+                const char *intern(const std::string &name)
+                    {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    return names.insert(name).first->c_str();
+                    }
+
+                void clear()
+                    {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (Buffer *buffer : buffers)
+                        { buffer->clear(); }
+                    }
+
+                void write_json(std::ostream &out)
+                    {
+                    double ns_per_tick = instrument::clock().ns_per_tick();
+                    std::lock_guard<std::mutex> lock(mutex);
+                    std::ios::fmtflags flags = out.flags();
+                    out << std::fixed;
+                    out << "{\"traceEvents\":[";
+                    bool first = true;
+                    for (Buffer *buffer : buffers)
+                        {
+                        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                            << buffer->thread << ",\"args\":{\"name\":\"thread " << buffer->thread << "\"}}";
+                        first = false;
+                        buffer->read(
+                                [&](char phase, const char *name, std::uint64_t ticks, std::uint64_t id)
+                                    {
+                                    out << ",\n{\"name\":\"";
+                                    for (const char *c = name; *c != '\0'; c++)
+                                        {
+                                        if (*c == '"' || *c == '\\')
+                                            { out << '\\'; }
+                                        if (static_cast<unsigned char>(*c) >= 0x20)
+                                            { out << *c; }
+                                        }
+                                    out << "\",\"cat\":\"wevents\",\"ph\":\"" << phase << "\",\"pid\":1,\"tid\":"
+                                        << buffer->thread << ",\"ts\":" << instrument::clock().to_ns(ticks, ns_per_tick) / 1000.0;
+                                    if (phase == FLOW_START || phase == FLOW_END)
+                                        { out << ",\"id\":" << id; }
+                                    if (phase == FLOW_END)
+                                        { out << ",\"bp\":\"e\""; }
+                                    out << "}";
+                                    }
+                        );
+                        }
+                    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+                    out.flags(flags);
+                    }
+                };
+
+            //never destroyed so threads exiting during static destruction can still record
+            inline Tracer &tracer()
+                {
+                static Tracer *instance = new Tracer();
+                return *instance;
+                }
+
+            inline Buffer *local_buffer()
+                {
+                static thread_local Buffer *buffer = nullptr;
+                if (buffer == nullptr)
+                    { buffer = tracer().create_buffer(); }
+                return buffer;
+                }
+
+            inline bool enabled()
+                { return tracer().enabled.load(std::memory_order_relaxed); }
+
+            //begin and end event around its own lifetime, nothing is written if tracing was off when it began
+            class Span
+                {
+            private:
+                const char *name;
+
+            public:
+                explicit Span(const char *name)
+                        : name(name != nullptr && enabled() ? name : nullptr)
+                    {
+                    if (this->name != nullptr)
+                        { local_buffer()->write(BEGIN, name, 0); }
+                    }
+
+                ~Span()
+                    {
+                    if (name != nullptr)
+                        { local_buffer()->write(END, name, 0); }
+                    }
+
+                Span(const Span &) = delete;
+                Span &operator=(const Span &) = delete;
+                };
+
+            //0 when tracing is off, the id links the hand off on the emitting thread to the call on the executing one
+            inline std::uint64_t flow_start(const char *name)
+                {
+                if (!enabled())
+                    { return 0; }
+                std::uint64_t id = tracer().next_flow.fetch_add(1, std::memory_order_relaxed);
+                local_buffer()->write(FLOW_START, name, id);
+                return id;
+                }
+
+            inline void flow_end(const char *name, std::uint64_t id)
+                {
+                if (id != 0 && enabled())
+                    { local_buffer()->write(FLOW_END, name, id); }
+                }
+
+            //carried along with an asynchronous call from the emitting thread to the executing one
+            struct Flow
+                {
+                const char *name;
+                std::uint64_t id;
+
+                static Flow start(const char *name)
+                    { return {name, flow_start(name)}; }
+                };
+
+            //the executing side of a Flow, a span with the end of the flow arrow bound to it
+            class FlowScope
+                {
+            private:
+                Span span;
+
+            public:
+                explicit FlowScope(const Flow &flow)
+                        : span(flow.id != 0 ? flow.name : nullptr)
+                    { flow_end(flow.name, flow.id); }
+                };
+#else
+            //compiled out, these are empty so the hooks in signals and properties cost nothing
+
+            class Span
+                {
+            public:
+                explicit Span(const char *)
+                    {}
+                };
+
+            struct Flow
+                {
+                static Flow start(const char *)
+                    { return Flow(); }
+                };
+
+            class FlowScope
+                {
+            public:
+                explicit FlowScope(const Flow &)
+                    {}
+                };
+#endif
+            }
+        }
+
+    //recording only happens between start_tracing() and stop_tracing() and only if the library is
+    //compiled with WEVENTS_TRACING, otherwise these do nothing and the written trace is empty
+    inline void start_tracing()
+        {
+#ifdef WEVENTS_TRACING
+        internal::trace::tracer().enabled.store(true, std::memory_order_relaxed);
+#endif
+        }
+
+    inline void stop_tracing()
+        {
+#ifdef WEVENTS_TRACING
+        internal::trace::tracer().enabled.store(false, std::memory_order_relaxed);
+#endif
+        }
+
+    //drops everything recorded so far, meant to be called while nothing is being traced
+    inline void clear_trace()
+        {
+#ifdef WEVENTS_TRACING
+        internal::trace::tracer().clear();
+#endif
+        }
+
+    //chrome trace event json, opens in chrome://tracing and in the perfetto ui
+    inline void write_chrome_trace(std::ostream &out)
+        {
+#ifdef WEVENTS_TRACING
+        internal::trace::tracer().write_json(out);
+#else
+        out << "{\"traceEvents\":[]}\n";
+#endif
+        }
+
+    inline bool write_chrome_trace(const std::string &path)
+        {
+        std::ofstream out(path);
+        if (!out)
+            { return false; }
+        write_chrome_trace(out);
+        return bool(out);
+        }
+    }
+
+#endif //WEVENTS_W_TRACE_H